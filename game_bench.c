@@ -0,0 +1,185 @@
+/*  Benchmark of the game engine: cpu cycles per game tick (snake_game_update()),
+ * per frame (drawing of map and image_show_max7219()) and per rabbit placement
+ * (snake_spawn_rabbit()) for a bot, which plays a few games.
+ * Result is one line to USART (9600 8n1), then mcu sleeps with interrupts
+ * disabled (simulator stops there):
+ *  bench ticks=N tick_avg=C tick_max=C frame_avg=C rabbit_avg=C rabbit_max=C
+ *  Made for tools/bench_suite.py, which builds it with different configurations
+ * and runs it in simavr, but works on hardware as well:
+ *  make TARGET=game_bench flash
+ *  Optional macros (game configuration, as in main.c):
+ *  MAX_SNAKE_LENGTH -- default is 64
+ *  SNAKE_GAME_WIDTH, SNAKE_GAME_HEIGHT -- default is 8x8, only top left 8x8
+ *   corner is drawn
+ *  BENCH_NTICKS -- default is 2000
+ *  BENCH_SPAWN_MODE -- default is SPAWN_SPACIOUS
+ * and any macros of snake_game.h and drawing.h
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <util/delay.h>
+#include <stdlib.h>
+
+#ifndef MAX_SNAKE_LENGTH
+#define MAX_SNAKE_LENGTH 64
+#endif
+#ifndef SNAKE_GAME_WIDTH
+#define SNAKE_GAME_WIDTH 8
+#endif
+#ifndef SNAKE_GAME_HEIGHT
+#define SNAKE_GAME_HEIGHT 8
+#endif
+#ifndef BENCH_NTICKS
+#define BENCH_NTICKS 2000
+#endif
+#ifndef BENCH_SPAWN_MODE
+#define BENCH_SPAWN_MODE SPAWN_SPACIOUS
+#endif
+
+#include "drawing.h"
+#include "snake_game.h"
+#include "uart.h"
+
+/* rabbit placement is measured on every BENCH_RABBIT_EVERY tick */
+#define BENCH_RABBIT_EVERY 8
+
+snake_game_t game;
+
+void print_P(const char *str)
+{
+	for (char c; (c = pgm_read_byte(str)); ++str) {
+		while (!uart_tx_free())
+			;
+		uart_putc(c);
+	}
+}
+
+void print_number(uint32_t number)
+{
+	char buf[11];
+	ultoa(number, buf, 10);
+	for (char *c = buf; *c; ++c) {
+		while (!uart_tx_free())
+			;
+		uart_putc(*c);
+	}
+}
+
+/* goes to rabbit, if the cell in that direction is empty, otherwise to any empty cell */
+snake_dir_t choose_dir()
+{
+	static const int8_t dirs[] = { DIR_UP, DIR_LEFT, DIR_DOWN, DIR_RIGHT };
+	cell_idx_t head = game.snake.segments[game.snake.head];
+	snake_dir_t saved = game.snake.dir;
+	snake_dir_t best = DIR_UNKNOWN;
+
+	snake_dir_t wanted =
+		SNAKE_CELL_X(game.rabbit) < SNAKE_CELL_X(head) ? DIR_LEFT
+		: SNAKE_CELL_X(game.rabbit) > SNAKE_CELL_X(head) ? DIR_RIGHT
+		: SNAKE_CELL_Y(game.rabbit) < SNAKE_CELL_Y(head) ? DIR_UP : DIR_DOWN;
+
+	for (byte_t i = 0; i <= ARR_SZ(dirs); ++i) {
+		snake_dir_t dir = (i == 0) ? wanted : (snake_dir_t) dirs[i - 1];
+		if (dir == -saved)
+			continue;
+		game.snake.dir = dir;
+		cell_idx_t next = snake_next_head_pos(&game.snake);
+		if (next != SNAKE_CELL_NONE && !WALL_ELEM(game.walls, next)
+			&& MAP_ELEM(game.map, next) != CELL_SNAKE) {
+			best = dir;
+			break;
+		}
+	}
+	game.snake.dir = saved;
+	return best;
+}
+
+/* timer1 counts cpu cycles, interrupts must be disabled */
+uint16_t measure_frame()
+{
+	TCNT1 = 0;
+	image_t image = {};
+	cell_idx_t cell = 0;
+	for (byte_t y = 0; y < SNAKE_GAME_HEIGHT; ++y)
+		for (byte_t x = 0; x < SNAKE_GAME_WIDTH; ++x, ++cell)
+			if (x < MAX_IMAGE_WIDTH && y < MAX_IMAGE_HEIGHT && MAP_ELEM(game.map, cell))
+				image_set_px(image, y, MAX_IMAGE_WIDTH - x - 1);
+	image_show_max7219(image);
+	return TCNT1;
+}
+
+/* the rabbit is taken away and put again */
+uint16_t measure_rabbit()
+{
+	MAP_ELEM(game.map, game.rabbit) = CELL_EMPTY;
+	TCNT1 = 0;
+	snake_spawn_rabbit(&game);
+	return TCNT1;
+}
+
+int main()
+{
+	max7219_init_ports();
+	max7219_clear_digits();
+	max7219_set_ndigits(8);
+	max7219_set_intencity(1);
+	max7219_wakeup();
+
+	uart_init();
+	TCCR1A = 0;
+	TCCR1B = 1 << CS10; // no prescaling
+
+	uint32_t tick_total = 0, frame_total = 0, rabbit_total = 0;
+	uint16_t tick_max = 0, rabbit_max = 0, nrabbits = 0;
+
+	game.seed = 1;
+	game.spawn_mode = BENCH_SPAWN_MODE;
+	snake_game_init(&game);
+	for (uint16_t i = 0; i < BENCH_NTICKS; ++i) {
+		if (game.is_finished)
+			snake_game_init(&game);
+		snake_dir_t dir = choose_dir();
+
+		TCNT1 = 0;
+		snake_game_update(&game, dir);
+		uint16_t cycles = TCNT1;
+		tick_total += cycles;
+		if (cycles > tick_max)
+			tick_max = cycles;
+
+		frame_total += measure_frame();
+		if (i % BENCH_RABBIT_EVERY == 0 && !game.is_finished) {
+			cycles = measure_rabbit();
+			rabbit_total += cycles;
+			if (cycles > rabbit_max)
+				rabbit_max = cycles;
+			++nrabbits;
+		}
+	}
+
+	sei();
+	print_P(PSTR("bench ticks="));
+	print_number(BENCH_NTICKS);
+	print_P(PSTR(" tick_avg="));
+	print_number(tick_total / BENCH_NTICKS);
+	print_P(PSTR(" tick_max="));
+	print_number(tick_max);
+	print_P(PSTR(" frame_avg="));
+	print_number(frame_total / BENCH_NTICKS);
+	print_P(PSTR(" rabbit_avg="));
+	print_number(nrabbits ? rabbit_total / nrabbits : 0);
+	print_P(PSTR(" rabbit_max="));
+	print_number(rabbit_max);
+	print_P(PSTR("\r\n"));
+
+	while (uart_tx_free() < UART_TX_BUFFER_SIZE - 1)
+		;
+	_delay_ms(5); // the last byte is being sent
+	cli();
+	sleep_enable();
+	sleep_cpu();
+	return 0;
+}
@@ -0,0 +1,56 @@
+/* Player of animations, baked into program memory
+ *
+ *  Effects from effects.h compute every frame at runtime. Animations, listed
+ * in assets/animations.txt, are rendered by tools/animc.py at build time
+ * into frames, which keep only rows changed since the previous frame
+ * (format is described in tools/animc.py), so playing costs a few cycles per
+ * changed row and the player is the same for all of them.
+ *  Animation is compiled only if ANIM_USING_<NAME> is defined before
+ * including this file, so every effect may be baked or computed, e.g.
+ *  #define ANIM_USING_COUNTDOWN // -> anim_countdown
+ *  Frames are shown with image_show_max7219() and timed with timer1a_wait_ms(),
+ * like effects are.
+ */
+
+#ifndef ANIM_H_
+#define ANIM_H_
+
+#include <avr/pgmspace.h>
+#include "decls.h"
+#include "drawing.h"
+#include "timing.h"
+
+typedef const uint8_t canim_t[];
+
+#include "anim_assets.h"
+
+/* blocks until the last frame is shown and held */
+void anim_play(canim_t anim)
+{
+	const byte_t *p = anim;
+	uint16_t period_ms = pgm_read_word(p);
+	image_t image = {};
+	bool_t is_first = true;
+
+	for (p += 2;; ) {
+		byte_t mask = pgm_read_byte(p++);
+		if (!mask) {
+			byte_t nperiods = pgm_read_byte(p++);
+			if (!nperiods)
+				break;
+			while (nperiods--)
+				timer1a_wait_ms(period_ms);
+			continue;
+		}
+
+		if (!is_first)
+			timer1a_wait_ms(period_ms);
+		is_first = false;
+		for (byte_t row = 0; mask; ++row, mask >>= 1)
+			if (mask & 1)
+				image[row] = pgm_read_byte(p++);
+		image_show_max7219(image);
+	}
+}
+
+#endif // ANIM_H_
@@ -0,0 +1,54 @@
+/* Generated by tools/animc.py from assets/animations.txt, do not edit.
+ * Included from anim.h */
+
+#ifndef ANIM_ASSETS_H_
+#define ANIM_ASSETS_H_
+
+#ifdef ANIM_USING_COUNTDOWN
+	// 5 frames by 1000 ms, 26 bytes
+	canim_t anim_countdown PROGMEM = {
+		0xE8, 0x03, 0x7C, 0x1C, 0x04, 0x1C, 0x04, 0x1C, 0x20, 0x10, 0x7C, 0x04,
+		0x0C, 0x14, 0x04, 0x04, 0x7C, 0x72, 0x52, 0x52, 0x50, 0x72, 0x00, 0x01,
+		0x00, 0x00,
+	};
+#endif
+
+#ifdef ANIM_USING_GOOD_MARK_TEXT
+	// 49 frames by 250 ms, 269 bytes
+	canim_t anim_good_mark_text PROGMEM = {
+		0xFA, 0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7C,
+		0x01, 0x01, 0x01, 0x01, 0x01, 0x7C, 0x03, 0x02, 0x02, 0x02, 0x02, 0x7C,
+		0x07, 0x05, 0x05, 0x05, 0x05, 0x7C, 0x0E, 0x0A, 0x0A, 0x0A, 0x0A, 0x7C,
+		0x1C, 0x15, 0x15, 0x15, 0x14, 0x7C, 0x39, 0x2A, 0x2A, 0x2A, 0x29, 0x7C,
+		0x72, 0x55, 0x55, 0x55, 0x52, 0x7C, 0xE4, 0xAA, 0xAA, 0xAA, 0xA4, 0x7C,
+		0xC8, 0x55, 0x55, 0x55, 0x48, 0x7C, 0x91, 0xAA, 0xAA, 0xAA, 0x91, 0x7C,
+		0x23, 0x54, 0x54, 0x54, 0x23, 0x7C, 0x46, 0xA8, 0xA8, 0xA8, 0x46, 0x7C,
+		0x8D, 0x50, 0x50, 0x50, 0x8C, 0x7C, 0x1B, 0xA1, 0xA1, 0xA1, 0x19, 0x7C,
+		0x37, 0x42, 0x42, 0x42, 0x32, 0x7C, 0x6E, 0x84, 0x84, 0x84, 0x64, 0x7C,
+		0xDC, 0x09, 0x09, 0x09, 0xC9, 0x7C, 0xB9, 0x12, 0x13, 0x12, 0x92, 0x7C,
+		0x72, 0x25, 0x27, 0x25, 0x25, 0x7C, 0xE4, 0x4A, 0x4E, 0x4A, 0x4A, 0x7C,
+		0xC9, 0x95, 0x9D, 0x95, 0x95, 0x7C, 0x93, 0x2A, 0x3B, 0x2A, 0x2B, 0x7C,
+		0x26, 0x55, 0x76, 0x55, 0x56, 0x7C, 0x4C, 0xAA, 0xEC, 0xAA, 0xAC, 0x7C,
+		0x99, 0x55, 0xD9, 0x55, 0x59, 0x7C, 0x32, 0xAA, 0xB3, 0xAA, 0xB3, 0x7C,
+		0x64, 0x54, 0x67, 0x55, 0x67, 0x7C, 0xC8, 0xA8, 0xCE, 0xAA, 0xCE, 0x7C,
+		0x91, 0x50, 0x9C, 0x54, 0x9C, 0x7C, 0x23, 0xA1, 0x39, 0xA9, 0x39, 0x7C,
+		0x47, 0x42, 0x72, 0x52, 0x72, 0x7C, 0x8E, 0x84, 0xE4, 0xA4, 0xE4, 0x7C,
+		0x1D, 0x09, 0xC9, 0x49, 0xC9, 0x7C, 0x3B, 0x12, 0x93, 0x92, 0x93, 0x7C,
+		0x77, 0x24, 0x27, 0x24, 0x27, 0x7C, 0xEE, 0x48, 0x4E, 0x48, 0x4E, 0x7C,
+		0xDC, 0x90, 0x9C, 0x90, 0x9C, 0x7C, 0xB8, 0x20, 0x38, 0x20, 0x38, 0x7C,
+		0x70, 0x40, 0x70, 0x40, 0x70, 0x7C, 0xE0, 0x80, 0xE0, 0x80, 0xE0, 0x7C,
+		0xC0, 0x00, 0xC0, 0x00, 0xC0, 0x54, 0x80, 0x80, 0x80, 0x54, 0x00, 0x00,
+		0x00, 0x00, 0x05, 0x00, 0x00,
+	};
+#endif
+
+#ifdef ANIM_USING_GOOD_MARK_SPLIT
+	// 5 frames by 700 ms, 30 bytes
+	canim_t anim_good_mark_split PROGMEM = {
+		0xBC, 0x02, 0x7C, 0x27, 0x65, 0xA5, 0x25, 0x27, 0x7C, 0x43, 0xC2, 0x42,
+		0x42, 0x43, 0x7C, 0x81, 0x81, 0x81, 0x81, 0x81, 0x7C, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+	};
+#endif
+
+#endif // ANIM_ASSETS_H_
@@ -30,6 +30,11 @@
 #define ASYNC_JOYSTICK_H_
 
 #include "decls.h"
+#include "power.h"
+
+/*  Microseconds between samples: a conversion is 13 adc clocks of F_CPU/128,
+ * next one is started from the interrupt (see power_idle_conversions()) */
+#define ASYNC_JOYSTICK_CONVERSION_US (13 * 128 * 1000000UL / F_CPU)
 
 typedef void (*PFN_joystick_callback)(joystick_dir_t dir);
 
@@ -89,7 +94,8 @@ ISR(ADC_vect)
 {
 	static volatile int8_t joystick_new_x;
 	int8_t adc_val = ((int16_t) ADC) / 10 - 51;
-	
+
+	power_account_sample(); // conversions have fixed rate, good for sampling
 	if (_joystick_current_pin == eJoystickCurrentPinVX) {
 		joystick_new_x = adc_val;
 		_joystick_current_pin = eJoystickCurrentPinVY;
@@ -105,6 +111,8 @@ ISR(ADC_vect)
 		_joystick_prev_y = joystick_new_y;
 		_joystick_current_pin = eJoystickCurrentPinVX;
 
+		if (prev_dir != new_dir)
+			FLIGHTREC_EVENT(FR_DIR, new_dir);
 		if (invoke_callback)
 			_joystick_callback(new_dir);
 
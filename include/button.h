@@ -1,18 +1,68 @@
 /* interraction with buttons
- * BUTTON_PORT, BUTTON_PORTDD, BUTTON_PORTIN must be defined */
+ * BUTTON_PORT, BUTTON_PORTDD, BUTTON_PORTIN must be defined
+ *
+ *  button_is_pressed() is a raw pin read. For debounced state and
+ * press/release events call button_service_start(): all pins, configured
+ * with button_init_ports(), are sampled every systick period with integrating
+ * debounce (state changes after BUTTON_DEBOUNCE_TICKS consistent samples).
+ * Events are queued and may be read with button_get_event() at any moment.
+ *  Optional macros:
+ *  BUTTON_DEBOUNCE_TICKS -- default is 5 (10 ms with default systick)
+ *  BUTTON_LONG_PRESS_MS -- default is 1000
+ *  BUTTON_EVENT_QUEUE_SIZE -- must be a power of 2, default is 4
+ *  BUTTON_NPINS -- pins from 0 to BUTTON_NPINS - 1 may be sampled, each costs
+ *   3 bytes of RAM, default is 8
+ */
 
 #ifndef BUTTON_H_
 #define BUTTON_H_
 
 #include "decls.h"
+#include "systick.h"
+
+#ifndef BUTTON_DEBOUNCE_TICKS
+#define BUTTON_DEBOUNCE_TICKS 5
+#endif // BUTTON_DEBOUNCE_TICKS
+
+#ifndef BUTTON_LONG_PRESS_MS
+#define BUTTON_LONG_PRESS_MS 1000
+#endif // BUTTON_LONG_PRESS_MS
+
+#ifndef BUTTON_EVENT_QUEUE_SIZE
+#define BUTTON_EVENT_QUEUE_SIZE 4
+#endif // BUTTON_EVENT_QUEUE_SIZE
+
+#ifndef BUTTON_NPINS
+#define BUTTON_NPINS 8
+#endif // BUTTON_NPINS
 
 typedef byte_t button_pin_t;
 
-/* pin must be from 0 to 7 */
+typedef enum {
+	BUTTON_PRESSED, BUTTON_RELEASED, BUTTON_LONG_PRESSED
+} button_event_type_t;
+
+typedef struct {
+	byte_t type; // button_event_type_t
+	button_pin_t pin;
+	uint16_t time; // systick_now() at the moment of event
+} button_event_t;
+
+static byte_t _button_mask; // pins configured with button_init_ports()
+static volatile byte_t _button_state; // debounced, 1 = pressed
+static byte_t _button_long_reported;
+static byte_t _button_integrators[BUTTON_NPINS];
+static uint16_t _button_press_time[BUTTON_NPINS];
+
+static button_event_t _button_events[BUTTON_EVENT_QUEUE_SIZE];
+static volatile byte_t _button_events_head, _button_events_tail;
+
+/* pin must be below BUTTON_NPINS */
 void button_init_ports(button_pin_t pin)
 {
 	BIT_CLEAR(BUTTON_PORTDD, pin); // set as input
 	BIT_SET(BUTTON_PORT, pin); // enable pull-up resistor
+	BIT_SET(_button_mask, pin);
 }
 
 /* pin must be from 0 to 7 */
@@ -21,4 +71,92 @@ bool_t button_is_pressed(button_pin_t pin)
 	return !(BUTTON_PORTIN & (1 << pin));
 }
 
-#endif // BUTTON_H_
\ No newline at end of file
+/* debounced state, button_service_start() must be called beforehand */
+bool_t button_is_down(button_pin_t pin)
+{
+	return !!(_button_state & (1 << pin));
+}
+
+/* queue overflow drops the newest events */
+static void _button_push_event(button_event_type_t type, button_pin_t pin, uint16_t time)
+{
+	byte_t next = (_button_events_head + 1) & (BUTTON_EVENT_QUEUE_SIZE - 1);
+	if (next == _button_events_tail)
+		return;
+	_button_events[_button_events_head].type = type;
+	_button_events[_button_events_head].pin = pin;
+	_button_events[_button_events_head].time = time;
+	_button_events_head = next;
+	FLIGHTREC_EVENT(FR_BUTTON, type << 4 | pin);
+}
+
+/* adds event as if it came from a real button, e.g. from remote control */
+void button_inject_event(button_event_type_t type, button_pin_t pin)
+{
+	byte_t sreg = SREG;
+	cli();
+	_button_push_event(type, pin, _systick_ticks);
+	SREG = sreg;
+}
+
+/* called from systick interrupt */
+void button_service_tick()
+{
+	byte_t pressed = ~BUTTON_PORTIN & _button_mask;
+	uint16_t now = _systick_ticks;
+
+	for (button_pin_t pin = 0; pin < BUTTON_NPINS; ++pin) {
+		byte_t bit = 1 << pin;
+		if (!(_button_mask & bit))
+			continue;
+
+		if (pressed & bit) {
+			if (_button_integrators[pin] < BUTTON_DEBOUNCE_TICKS
+				&& ++_button_integrators[pin] == BUTTON_DEBOUNCE_TICKS
+				&& !(_button_state & bit)) {
+				_button_state |= bit;
+				_button_long_reported &= ~bit;
+				_button_press_time[pin] = now;
+				_button_push_event(BUTTON_PRESSED, pin, now);
+			}
+		} else if (_button_integrators[pin] > 0
+			&& --_button_integrators[pin] == 0
+			&& (_button_state & bit)) {
+			_button_state &= ~bit;
+			_button_push_event(BUTTON_RELEASED, pin, now);
+		}
+
+		if ((_button_state & bit) && !(_button_long_reported & bit)
+			&& now - _button_press_time[pin] >= SYSTICK_MS_TO_TICKS(BUTTON_LONG_PRESS_MS)) {
+			_button_long_reported |= bit;
+			_button_push_event(BUTTON_LONG_PRESSED, pin, now);
+		}
+	}
+}
+
+/*  Starts sampling buttons on systick. Systick is (re)started, so if you
+ * need it for something else, call button_service_tick() from your
+ * own systick callback instead */
+void button_service_start()
+{
+	_button_events_head = _button_events_tail = 0;
+	systick_start(button_service_tick);
+}
+
+bool_t button_has_events()
+	{ return _button_events_head != _button_events_tail; }
+
+/* Nonblock, returns false if there are no events */
+bool_t button_get_event(button_event_t *event)
+{
+	if (!button_has_events())
+		return false;
+	*event = _button_events[_button_events_tail];
+	_button_events_tail = (_button_events_tail + 1) & (BUTTON_EVENT_QUEUE_SIZE - 1);
+	return true;
+}
+
+void button_flush_events()
+	{ _button_events_tail = _button_events_head; }
+
+#endif // BUTTON_H_
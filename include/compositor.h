@@ -0,0 +1,157 @@
+/* Layered composition of 8x8 images
+ *
+ *  Compositor keeps COMPOSITOR_NLAYERS images (layers), e.g. game board,
+ * blinking objects and overlay text, and combines enabled ones bottom-up
+ * (layer 0 first): out = blend(out, layer row), blend is OR, AND-NOT or XOR.
+ *  Output has COMPOSITOR_NPLANES bit-planes (as greyscale_image_t), a layer
+ * with level L goes only into planes, whose bits are set in L, so with
+ * OR blending lit pixels of layer get level L on empty background, XOR with
+ * the max level inverts levels, etc. With 1 plane level is 1 (or 0 - layer
+ * is invisible).
+ *  Writes to layers mark rows dirty only if something is really changed,
+ * and compositor_compose() recomputes only dirty rows, so unchanged layers
+ * and rows cost nothing. Compositor isn't protected from interrupts, all
+ * writes and composition should be done in the same context.
+ *  Optional macros:
+ *  COMPOSITOR_NLAYERS -- from 1 to 8, default is 4 (9 bytes of RAM per layer)
+ *  COMPOSITOR_NPLANES -- planes in output, default is 1
+ */
+
+#ifndef COMPOSITOR_H_
+#define COMPOSITOR_H_
+
+#include "decls.h"
+#include "drawing.h"
+
+#ifndef COMPOSITOR_NLAYERS
+#define COMPOSITOR_NLAYERS 4
+#endif // COMPOSITOR_NLAYERS
+
+#if COMPOSITOR_NLAYERS < 1 || COMPOSITOR_NLAYERS > 8
+#error "COMPOSITOR_NLAYERS must be from 1 to 8"
+#endif
+
+#ifndef COMPOSITOR_NPLANES
+#define COMPOSITOR_NPLANES 1
+#endif // COMPOSITOR_NPLANES
+
+#define COMPOSITOR_ALL_ROWS 0xFF
+
+typedef enum {
+	COMPOSITOR_OR, // pixels are lit
+	COMPOSITOR_ANDNOT, // pixels are cleared
+	COMPOSITOR_XOR // pixels are inverted
+} compositor_blend_t;
+
+typedef struct {
+	image_t rows;
+	byte_t mode; // level << 2 | compositor_blend_t
+} compositor_layer_t;
+
+typedef struct {
+	compositor_layer_t layers[COMPOSITOR_NLAYERS];
+	byte_t enabled; // bit per layer
+	byte_t dirty; // bit per row, which should be recomputed
+} compositor_t;
+
+/* output of composition, planes of greyscale_image_t with the same number of planes */
+typedef byte_t (*compositor_planes_t)[MAX_IMAGE_HEIGHT];
+
+/*  Layers are empty, disabled and have OR blending and level 1,
+ * all rows are dirty, so the whole output is composed next time */
+void compositor_init(compositor_t *c)
+{
+	for (byte_t l = 0; l < COMPOSITOR_NLAYERS; ++l) {
+		image_clear(c->layers[l].rows);
+		c->layers[l].mode = 1 << 2 | COMPOSITOR_OR;
+	}
+	c->enabled = 0;
+	c->dirty = COMPOSITOR_ALL_ROWS;
+}
+
+/* marks rows, where layer has something, after change of its mode */
+static void _compositor_touch_layer(compositor_t *c, byte_t layer)
+{
+	for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i)
+		if (c->layers[layer].rows[i])
+			BIT_SET(c->dirty, i);
+}
+
+void compositor_set_row(compositor_t *c, byte_t layer, byte_t row, byte_t val)
+{
+	if (c->layers[layer].rows[row] != val) {
+		c->layers[layer].rows[row] = val;
+		BIT_SET(c->dirty, row);
+	}
+}
+
+void compositor_set_image(compositor_t *c, byte_t layer, cimage_t image)
+{
+	for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i)
+		compositor_set_row(c, layer, i, image[i]);
+}
+
+/* image must be in program memory, see image_packed_row() */
+void compositor_set_packed_image(compositor_t *c, byte_t layer, cpacked_image_t packed)
+{
+	for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i)
+		compositor_set_row(c, layer, i, image_packed_row(packed, i));
+}
+
+void compositor_set_mode(compositor_t *c, byte_t layer, compositor_blend_t blend, byte_t level)
+{
+	byte_t mode = level << 2 | blend;
+	if (c->layers[layer].mode != mode) {
+		c->layers[layer].mode = mode;
+		if (c->enabled & (1 << layer))
+			_compositor_touch_layer(c, layer);
+	}
+}
+
+void compositor_enable(compositor_t *c, byte_t layer, bool_t enable)
+{
+	if (!(c->enabled & (1 << layer)) != !enable) {
+		c->enabled ^= 1 << layer;
+		_compositor_touch_layer(c, layer);
+	}
+}
+
+bool_t compositor_is_enabled(const compositor_t *c, byte_t layer)
+	{ return (c->enabled & (1 << layer)) != 0; }
+
+/*  Writes dirty rows into all planes of out, other rows of out are not
+ * touched. Returns mask of written rows, 0 if nothing was changed */
+byte_t compositor_compose(compositor_t *c, compositor_planes_t out)
+{
+	byte_t rows = c->dirty;
+	byte_t mask = 1;
+
+	for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i, mask <<= 1) {
+		if (!(rows & mask))
+			continue;
+
+		byte_t acc[COMPOSITOR_NPLANES] = { 0 };
+		for (byte_t l = 0; l < COMPOSITOR_NLAYERS; ++l) {
+			byte_t val = c->layers[l].rows[i];
+			if (!val || !(c->enabled & (1 << l)))
+				continue;
+
+			byte_t mode = c->layers[l].mode;
+			for (byte_t p = 0; p < COMPOSITOR_NPLANES; ++p) {
+				if (!(mode & (1 << (p + 2))))
+					continue;
+				switch (mode & 0x03) {
+				case COMPOSITOR_OR: acc[p] |= val; break;
+				case COMPOSITOR_ANDNOT: acc[p] &= ~val; break;
+				case COMPOSITOR_XOR: acc[p] ^= val; break;
+				}
+			}
+		}
+		for (byte_t p = 0; p < COMPOSITOR_NPLANES; ++p)
+			out[p][i] = acc[p];
+	}
+	c->dirty = 0;
+	return rows;
+}
+
+#endif // COMPOSITOR_H_
@@ -3,14 +3,27 @@
 #ifndef DECLS_H_
 #define DECLS_H_
 
+#ifdef __AVR__
 #include <avr/io.h>
+#include <avr/pgmspace.h>
+#else
+/* platform-independent parts may be built on host,
+ * where program memory is ordinary memory */
+#include <stdint.h>
+#include <string.h>
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *) (addr))
+#define memcpy_P memcpy
+#endif
 
 typedef uint8_t byte_t;
 typedef int8_t bool_t;
 
 #define true 1
 #define false 0
+#ifndef NULL
 #define NULL ((void *) 0)
+#endif
 
 #define BIT_SET(val, bitno) ((val) |= (1UL << (bitno)))
 #define BIT_CLEAR(val, bitno) ((val) &= ~(1UL << (bitno)))
@@ -21,4 +34,24 @@ typedef int8_t bool_t;
 
 #define ARR_SZ(arr) (sizeof arr / sizeof arr[0])
 
+/*  Flight recorder hook, modules call it on notable events (see flightrec.h).
+ * It does nothing, unless FLIGHTREC_ENABLE is defined before any include */
+typedef enum {
+	FR_TICK_START = 1, // score
+	FR_TICK_END, // score
+	FR_DIR, // new joystick direction
+	FR_RABBIT, // new rabbit cell
+	FR_FLUSH, // frame sent to display, number of rows or 0 if it's sent later
+	FR_BUTTON, // button event type << 4 | pin
+	FR_GAME_OVER, // score
+	FR_TRIGGER // recorder frozen on request
+} flightrec_event_t;
+
+#ifdef FLIGHTREC_ENABLE
+static inline void flightrec_event(uint8_t type, uint8_t arg);
+#define FLIGHTREC_EVENT(type, arg) flightrec_event(type, arg)
+#else
+#define FLIGHTREC_EVENT(type, arg) ((void) 0)
+#endif // FLIGHTREC_ENABLE
+
 #endif // DECLS_H_
\ No newline at end of file
@@ -1,12 +1,20 @@
 /*  Provides some bit-images for drawing on a 8x8 led matrix,
  * including digits and letters
- *  Pre-defined pictures are stored in program memory.
- * Use syntax like image_show(image_progread(prog_img_smile)) to show them
+ *  Pre-defined pictures and font are stored in program memory in packed
+ * form (see drawing_assets.h, which is generated by tools/assetc.py from
+ * assets/font.txt and assets/images.txt). They are decoded row by row
+ * directly into destination, use image_show_packed_max7219(prog_img_smile)
+ * to show a picture or image_draw_packed() to draw it into image.
  *  By default pre-defined images are disabled to minimize flashing time,
  * define macros to enable them:
  * #define DRAWING_USING_COMMON_IMAGES // -> smiles, arrows, etc
  * #define DRAWING_USING_NUMBERS // -> digits
- * #define DRAWING_USING_LETTERS // -> english alphabet letters
+ * #define DRAWING_USING_LETTERS // -> english alphabet letters, digits and some punctuation
+ *  Images are sent to max7219 right away by default. Define
+ * DRAWING_USING_FRAMEBUFFER to show them through double-buffered frame
+ * (see framebuffer.h), then framebuffer_flush() must be called periodically.
+ *  Shown images are transformed according to DISPLAY_ORIENTATION (see
+ * orient.h), define it before including.
  *
  * Author: Graudt V.
  **/
@@ -21,25 +29,23 @@
  * only for 8x8 led matrices, driven by max7219 */
 #define MAX_IMAGE_HEIGHT 8
 #define MAX_IMAGE_WIDTH 8
-#define MAX_LETTER_HEIGHT 5
-#define MAX_LETTER_WIDTH 8
+#define FONT_HEIGHT 5
+#define FONT_SPACE_WIDTH 2 // space has no glyph
+#define FONT_GLYPH_SIZE 3 // 5 rows and width, packed into nibbles
 
 typedef uint8_t image_t[MAX_IMAGE_HEIGHT];
 typedef const uint8_t cimage_t[MAX_IMAGE_HEIGHT];
 typedef uint8_t *image_ref_t;
 
-/* letter is a small image, used for better space efficiency */
-typedef uint8_t letter_t[MAX_LETTER_HEIGHT];
-typedef const uint8_t cletter_t[MAX_LETTER_HEIGHT];
-typedef uint8_t *letter_ref_t;
+/* see tools/assetc.py for formats */
+typedef const uint8_t font_glyph_t[FONT_GLYPH_SIZE];
+typedef const uint8_t cpacked_image_t[];
 
-/* text is array of letters */
-typedef letter_t text_t[];
-typedef const letter_t ctext_t[];
-typedef letter_t *text_ref_t;
+#include "orient.h"
 
-static image_t _image_buffer;
-static letter_t _letter_buffer;
+#ifdef DRAWING_USING_FRAMEBUFFER
+#include "framebuffer.h"
+#endif
 
 /*  Note. Rows in image correspond to digits in max7219, columns - to segments.
  * (0, 0) in image is top right (!) corner on matrix. In such agreement
@@ -47,18 +53,36 @@ static letter_t _letter_buffer;
  * if image[0] = 0b00000010, a led near the right top corner will be glowing */
 void image_show_max7219(cimage_t image)
 {
+#ifdef DRAWING_USING_FRAMEBUFFER
+	framebuffer_show(image);
+#else
+#if DISPLAY_ORIENTATION != ORIENT_NORMAL
+	image_t oriented;
+	for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i)
+		oriented[i] = image[i];
+	orient_image(oriented, DISPLAY_ORIENTATION);
+	image = oriented;
+#endif
 	for (int i = 0; i < MAX_IMAGE_HEIGHT; ++i)
 		max7219_setdigit(i, image[i]);
+	FLIGHTREC_EVENT(FR_FLUSH, MAX_IMAGE_HEIGHT);
+#endif
 }
 
-/* x, y are from 0 to 7 */
-void image_emplace_letter_xy(image_t image, cletter_t letter, byte_t x, byte_t y)
+/* sends only rows, which differ from what is already shown */
+void image_update_max7219(cimage_t image)
 {
-	for (int i = 0; i < (sizeof(cletter_t) / sizeof letter[0]) ; ++i) {
-		byte_t mask = letter[i] << x;
-		image[i + y] &= ~mask;
-		image[i + y] |= mask;
-	}
+#if DISPLAY_ORIENTATION != ORIENT_NORMAL
+	image_t oriented;
+	for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i)
+		oriented[i] = image[i];
+	orient_image(oriented, DISPLAY_ORIENTATION);
+	image = oriented;
+#endif
+	byte_t nsent = 0;
+	for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i)
+		nsent += max7219_update_digit(i, image[i]);
+	FLIGHTREC_EVENT(FR_FLUSH, nsent);
 }
 
 void image_clear(image_t image)
@@ -79,163 +103,105 @@ void image_set_px(image_t image, int i, int j)
 	BIT_SET(image[i], j);
 }
 
-/*  Reads image from program memory to local buffer RAM
- * and returns pointer on that buffer. Buffer can be modified by user,
- * but note that will be overriden on the next call to image_progread() */
-image_ref_t image_progread(cimage_t image)
-	{ return memcpy_P(_image_buffer, image, sizeof(cimage_t)); }
-
-/* Similar to image_progread() */
-letter_ref_t letter_progread(cletter_t letter)
-	{ return memcpy_P(_letter_buffer, letter, sizeof(cletter_t)); }
-
-#ifdef DRAWING_USING_COMMON_IMAGES
-	cimage_t prog_img_smile PROGMEM = {
-		0b00000000,
-		0b01100110,
-		0b01100110,
-		0b00000000,
-		0b00000000,
-		0b01100110,
-		0b00111100,
-		0b00000000
-	};
-
-	cimage_t prog_img_sad_smile PROGMEM = {
-		0b00000000,
-		0b01100110,
-		0b01100110,
-		0b00000000,
-		0b00000000,
-		0b00111100,
-		0b01100110,
-		0b00000000
-	};
-
-	cimage_t prog_img_arrow_up PROGMEM = {
-		0b00000000,
-		0b00011000,
-		0b00111100,
-		0b01011010,
-		0b00011000,
-		0b00011000,
-		0b00011000,
-		0b00000000
-	};
-
-	cimage_t prog_img_arrow_down PROGMEM = {
-		0b00000000,
-		0b00011000,
-		0b00011000,
-		0b00011000,
-		0b01011010,
-		0b00111100,
-		0b00011000,
-		0b00000000
-	};
-
-	cimage_t prog_img_arrow_right PROGMEM = {
-		0b00000000,
-		0b00001000,
-		0b00000100,
-		0b01111110,
-		0b01111110,
-		0b00000100,
-		0b00001000,
-		0b00000000
-	};
-
-	cimage_t prog_img_arrow_left PROGMEM = {
-		0b00000000,
-		0b00010000,
-		0b00100000,
-		0b01111110,
-		0b01111110,
-		0b00100000,
-		0b00010000,
-		0b00000000
-	};
-#endif // DRAWING_USING_COMMON_IMAGES
-
-#ifdef DRAWING_USING_NUMBERS
-	const cletter_t small_digits[] PROGMEM = {
-		{ // zero
-			0b111,
-			0b101,
-			0b101,
-			0b101,
-			0b111
-		}, { // one 
-			0b001,
-			0b011,
-			0b101,
-			0b001,
-			0b001		
-		}, { // two
-			0b111,
-			0b001,
-			0b111,
-			0b100,
-			0b111
-		}, { // three
-			0b111,
-			0b001,
-			0b111,
-			0b001,
-			0b111
-		}, { // four
-			0b101,
-			0b101,
-			0b111,
-			0b001,
-			0b001
-		}, { // five
-			0b111,
-			0b100,
-			0b111,
-			0b001,
-			0b111
-		}, { // six
-			0b111,
-			0b100,
-			0b111,
-			0b101,
-			0b111
-		}, { // seven
-			0b111,
-			0b001,
-			0b010,
-			0b100,
-			0b100
-		}, { // eight
-			0b111,
-			0b101,
-			0b111,
-			0b101,
-			0b111
-		}, { // nine
-			0b111,
-			0b101,
-			0b111,
-			0b001,
-			0b111
-		}
-	};
+/* returns row of packed image, image must be in program memory */
+byte_t image_packed_row(cpacked_image_t image, byte_t row)
+{
+	byte_t header = pgm_read_byte(&image[0]);
+	byte_t i = row - (header >> 4); // unsigned, so rows above top are large
+	if (i >= (header & 0x0F))
+		return 0;
+
+	byte_t format = pgm_read_byte(&image[1]);
+	byte_t val;
+	if ((format & 0x0F) <= 4) { // rows are packed into nibbles
+		val = pgm_read_byte(&image[2 + i / 2]);
+		val = (i & 1) ? (val & 0x0F) : (val >> 4);
+	} else
+		val = pgm_read_byte(&image[2 + i]);
+	return val << (format >> 4);
+}
+
+/* ors packed image into image */
+void image_draw_packed(image_t image, cpacked_image_t packed)
+{
+	for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i)
+		image[i] |= image_packed_row(packed, i);
+}
+
+/* shows packed image without copying it to RAM */
+void image_show_packed_max7219(cpacked_image_t packed)
+{
+#ifdef DRAWING_USING_FRAMEBUFFER
+	image_ref_t back = framebuffer_back();
+	for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i)
+		back[i] = image_packed_row(packed, i);
+	framebuffer_flip();
+#elif DISPLAY_ORIENTATION != ORIENT_NORMAL
+	image_t image = {};
+	image_draw_packed(image, packed);
+	image_show_max7219(image);
+#else
+	for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i)
+		max7219_setdigit(i, image_packed_row(packed, i));
+	FLIGHTREC_EVENT(FR_FLUSH, MAX_IMAGE_HEIGHT);
+#endif
+}
 
-	void image_emplace_letter_left(image_t image, cletter_t letter) { image_emplace_letter_xy(image, letter, 5, 2); }
-	void image_emplace_letter_right(image_t image, cletter_t letter) { image_emplace_letter_xy(image, letter, 0, 2); }
-	void image_emplace_letter_center(image_t image, cletter_t letter) { image_emplace_letter_xy(image, letter, 2, 2); }
+#include "drawing_assets.h"
+
+#if defined(DRAWING_USING_NUMBERS) || defined(DRAWING_USING_LETTERS)
+	/* returns NULL if there is no glyph for c, lowercase letters are
+	 * shown as uppercase */
+	const byte_t *font_glyph(char c)
+	{
+		byte_t code = c;
+
+		if (code >= 'a' && code <= 'z')
+			code -= 'a' - 'A';
+		if (code >= FONT_FIRST_CHAR && code <= FONT_LAST_CHAR)
+			return font_glyphs[code - FONT_FIRST_CHAR];
+		if (code >= 0x80 && code < 0x80 + FONT_NEXTRA)
+			return font_glyphs[FONT_LAST_CHAR - FONT_FIRST_CHAR + 1 + code - 0x80];
+		return NULL;
+	}
+
+	byte_t font_glyph_width(char c)
+	{
+		const byte_t *glyph = font_glyph(c);
+		return glyph ? pgm_read_byte(&glyph[2]) & 0x0F : FONT_SPACE_WIDTH;
+	}
+
+	/*  Ors glyph into image, so that its right column is x columns away
+	 * from the right border of image and top row is y. Glyph is decoded
+	 * straight from program memory. Returns width of glyph */
+	byte_t image_draw_glyph(image_t image, char c, byte_t x, byte_t y)
+	{
+		const byte_t *glyph = font_glyph(c);
+		if (!glyph)
+			return FONT_SPACE_WIDTH;
+
+		byte_t b0 = pgm_read_byte(&glyph[0]);
+		byte_t b1 = pgm_read_byte(&glyph[1]);
+		byte_t b2 = pgm_read_byte(&glyph[2]);
+
+		image[y + 0] |= (b0 >> 4) << x;
+		image[y + 1] |= (b0 & 0x0F) << x;
+		image[y + 2] |= (b1 >> 4) << x;
+		image[y + 3] |= (b1 & 0x0F) << x;
+		image[y + 4] |= (b2 >> 4) << x;
+		return b2 & 0x0F;
+	}
 
 	/* number from 0 to 99 */
 	void image_emplace_number(image_t image, int number)
 	{
 		if (number < 10)
-			image_emplace_letter_center(image, letter_progread(small_digits[number % 10]));
+			image_draw_glyph(image, '0' + number, 2, 2); // center
 		else {
-			image_emplace_letter_right(image, letter_progread(small_digits[number % 10]));
-			image_emplace_letter_left(image, letter_progread(small_digits[number / 10]));
+			image_draw_glyph(image, '0' + number % 10, 0, 2); // right
+			image_draw_glyph(image, '0' + number / 10, 5, 2); // left
 		}
 	}
-#endif // DRAWING_USING_NUMBERS
+#endif
 
 #endif // DRAWING_H_
\ No newline at end of file
@@ -0,0 +1,87 @@
+/* Generated by tools/assetc.py from assets/font.txt and assets/images.txt, do not edit.
+ * Included from drawing.h */
+
+#ifndef DRAWING_ASSETS_H_
+#define DRAWING_ASSETS_H_
+
+#if defined(DRAWING_USING_NUMBERS) || defined(DRAWING_USING_LETTERS)
+#ifdef DRAWING_USING_LETTERS
+	#define FONT_FIRST_CHAR '-'
+	#define FONT_LAST_CHAR 'Z'
+	#define FONT_NEXTRA 2 // glyphs from 0x80
+	#define FONT_CHAR_PE "\x80"
+	#define FONT_CHAR_SOFT_SIGN "\x81"
+#else
+	#define FONT_FIRST_CHAR '0'
+	#define FONT_LAST_CHAR '9'
+	#define FONT_NEXTRA 0
+#endif
+
+	const font_glyph_t font_glyphs[] PROGMEM = {
+#ifdef DRAWING_USING_LETTERS
+		{ 0x00, 0x70, 0x03 }, // '-'
+		{ 0x00, 0x00, 0x11 }, // '.'
+		{ 0x00, 0x00, 0x02 }, // '/'
+#endif
+		{ 0x75, 0x55, 0x73 }, // '0'
+		{ 0x13, 0x51, 0x13 }, // '1'
+		{ 0x71, 0x74, 0x73 }, // '2'
+		{ 0x71, 0x71, 0x73 }, // '3'
+		{ 0x55, 0x71, 0x13 }, // '4'
+		{ 0x74, 0x71, 0x73 }, // '5'
+		{ 0x74, 0x75, 0x73 }, // '6'
+		{ 0x71, 0x24, 0x43 }, // '7'
+		{ 0x75, 0x75, 0x73 }, // '8'
+		{ 0x75, 0x71, 0x73 }, // '9'
+#ifdef DRAWING_USING_LETTERS
+		{ 0x01, 0x01, 0x01 }, // ':'
+		{ 0x00, 0x00, 0x02 }, // ';'
+		{ 0x00, 0x00, 0x02 }, // '<'
+		{ 0x00, 0x00, 0x02 }, // '='
+		{ 0x00, 0x00, 0x02 }, // '>'
+		{ 0x71, 0x20, 0x23 }, // '?'
+		{ 0x00, 0x00, 0x02 }, // '@'
+		{ 0x25, 0x75, 0x53 }, // 'A'
+		{ 0x65, 0x65, 0x63 }, // 'B'
+		{ 0x34, 0x44, 0x33 }, // 'C'
+		{ 0x65, 0x55, 0x63 }, // 'D'
+		{ 0x74, 0x74, 0x73 }, // 'E'
+		{ 0x74, 0x74, 0x43 }, // 'F'
+		{ 0x34, 0x55, 0x33 }, // 'G'
+		{ 0x55, 0x75, 0x53 }, // 'H'
+		{ 0x72, 0x22, 0x73 }, // 'I'
+		{ 0x11, 0x15, 0x23 }, // 'J'
+		{ 0x55, 0x65, 0x53 }, // 'K'
+		{ 0x44, 0x44, 0x73 }, // 'L'
+		{ 0x9F, 0xF9, 0x94 }, // 'M'
+		{ 0x9D, 0xB9, 0x94 }, // 'N'
+		{ 0x25, 0x55, 0x23 }, // 'O'
+		{ 0x65, 0x64, 0x43 }, // 'P'
+		{ 0x25, 0x56, 0x33 }, // 'Q'
+		{ 0x65, 0x65, 0x53 }, // 'R'
+		{ 0x34, 0x21, 0x63 }, // 'S'
+		{ 0x72, 0x22, 0x23 }, // 'T'
+		{ 0x55, 0x55, 0x73 }, // 'U'
+		{ 0x55, 0x55, 0x23 }, // 'V'
+		{ 0x99, 0xFF, 0x94 }, // 'W'
+		{ 0x55, 0x25, 0x53 }, // 'X'
+		{ 0x55, 0x22, 0x23 }, // 'Y'
+		{ 0x71, 0x24, 0x73 }, // 'Z'
+		{ 0x75, 0x55, 0x53 }, // 0x80 PE
+		{ 0x44, 0x75, 0x73 }, // 0x81 SOFT_SIGN
+#endif
+	};
+#endif
+
+#ifdef DRAWING_USING_COMMON_IMAGES
+	cpacked_image_t prog_img_smile PROGMEM = { 0x16, 0x16, 0x33, 0x33, 0x00, 0x00, 0x33, 0x1E };
+	cpacked_image_t prog_img_sad_smile PROGMEM = { 0x16, 0x16, 0x33, 0x33, 0x00, 0x00, 0x1E, 0x33 };
+	cpacked_image_t prog_img_arrow_up PROGMEM = { 0x16, 0x16, 0x0C, 0x1E, 0x2D, 0x0C, 0x0C, 0x0C };
+	cpacked_image_t prog_img_arrow_down PROGMEM = { 0x16, 0x16, 0x0C, 0x0C, 0x0C, 0x2D, 0x1E, 0x0C };
+	cpacked_image_t prog_img_arrow_right PROGMEM = { 0x16, 0x16, 0x04, 0x02, 0x3F, 0x3F, 0x02, 0x04 };
+	cpacked_image_t prog_img_arrow_left PROGMEM = { 0x16, 0x16, 0x08, 0x10, 0x3F, 0x3F, 0x10, 0x08 };
+	cpacked_image_t prog_img_countdown_go PROGMEM = { 0x25, 0x16, 0x39, 0x29, 0x29, 0x28, 0x39 };
+	cpacked_image_t prog_img_pause PROGMEM = { 0x16, 0x16, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33 };
+#endif // DRAWING_USING_COMMON_IMAGES
+
+#endif // DRAWING_ASSETS_H_
@@ -3,17 +3,30 @@
 #ifndef EFFECTS_H_
 #define EFFECTS_H_
 
+#include <avr/interrupt.h>
 #include "decls.h"
 #include "drawing.h"
 #include "timing.h"
+#if defined(DRAWING_USING_NUMBERS) || defined(DRAWING_USING_LETTERS)
+#include "scroller.h"
+#endif
+
+/* framebuffer_flush() may be called from interrupt in the middle of packet */
+static void _draw_effect_shutdown(bool_t enable)
+{
+	byte_t sreg = SREG;
+	cli();
+	max7219_enable_shutdown(enable);
+	SREG = sreg;
+}
 
 void draw_effect_blink(uint16_t delay_ms, int ntimes)
 {
 	for (int i = 0; i < ntimes; ++i) {
 		timer1a_wait_ms(delay_ms);
-		max7219_enable_shutdown(true);
+		_draw_effect_shutdown(true);
 		timer1a_wait_ms(delay_ms);
-		max7219_enable_shutdown(false);
+		_draw_effect_shutdown(false);
 	}
 }
 
@@ -33,15 +46,17 @@ void draw_effect_shift_left(cimage_t image, uint16_t step_speed_ms)
 
 void draw_effect_swap_shift_left(cimage_t fst, cimage_t snd, uint16_t step_speed_ms)
 {
-	image_t image_buf;
+	image_t image_buf, snd_buf;
 	image_cpy(image_buf, fst);
+	image_cpy(snd_buf, snd);
 	image_show_max7219(image_buf);
 
 	for (unsigned int i = 0; i < MAX_IMAGE_WIDTH; ++i) {
 		timer1a_wait_ms(step_speed_ms);
 		for (unsigned int row = 0; row < MAX_IMAGE_HEIGHT; ++row) {
-			image_buf[row] <<= 1;
-			BIT_SET_TO(image_buf[row], 0, snd[row] & (1 << MAX_IMAGE_WIDTH - i - 1));
+			/* left column of snd goes to the right column of image */
+			image_buf[row] = (image_buf[row] << 1) | (snd_buf[row] >> (MAX_IMAGE_WIDTH - 1));
+			snd_buf[row] <<= 1;
 		}
 		image_show_max7219(image_buf);
 	}
@@ -66,18 +81,50 @@ void draw_effect_shift_to_sides(cimage_t image, uint16_t step_speed_ms)
 	}
 }
 
-/* text must be in program memory, not RAM (!) */
-void draw_effect_moving_text(cletter_t *text, unsigned int text_len, uint16_t step_speed_ms)
+#if defined(DRAWING_USING_NUMBERS) || defined(DRAWING_USING_LETTERS)
+/*  text must be in program memory, not RAM (!)
+ *  Text is shown page by page, each page holds as many glyphs as fit
+ * into matrix width. After the last page text moves out of the screen */
+void draw_effect_moving_text(const char *text, uint16_t step_speed_ms)
 {
 	image_t left;
 	image_t right = {};
+	char c = pgm_read_byte(text);
 
-	for (int i = 0; i < text_len; ++i) {
+	for (;;) {
 		image_cpy(left, right);
 		image_clear(right);
-		image_emplace_letter_xy(right, image_progread(text[i]), 0, 2);
+
+		for (int8_t free_cols = MAX_IMAGE_WIDTH; c; c = pgm_read_byte(++text)) {
+			int8_t width = font_glyph_width(c);
+			if (width > free_cols)
+				break;
+			image_draw_glyph(right, c, free_cols - width, 2);
+			free_cols -= width + 1; // one column between glyphs
+		}
 		draw_effect_swap_shift_left(left, right, step_speed_ms);
+
+		bool_t is_empty_page = true;
+		for (int row = 0; row < MAX_IMAGE_HEIGHT; ++row)
+			is_empty_page &= !right[row];
+		if (!c && is_empty_page)
+			break;
+	}
+}
+
+/*  Scrolls text started with one of scroller_start() functions, until it
+ * moves out of the screen. Screen is not cleared beforehand */
+void draw_effect_scroll(scroller_t *s, image_t image, uint16_t step_speed_ms)
+{
+	byte_t nsteps_after_end = MAX_IMAGE_WIDTH;
+
+	while (nsteps_after_end) {
+		if (!scroller_step(s, image))
+			--nsteps_after_end;
+		image_show_max7219(image);
+		timer1a_wait_ms(step_speed_ms);
 	}
 }
+#endif
 
 #endif // EFFECTS_H_
\ No newline at end of file
@@ -0,0 +1,114 @@
+/* Flight recorder: ring of the last timestamped events for post-mortem analysis
+ *  Define FLIGHTREC_ENABLE before including anything, then FLIGHTREC_EVENT()
+ * calls in modules (see decls.h for event types) write records here.
+ * Otherwise the hook compiles to nothing.
+ *  A record is 5 bytes: type, argument, systick ticks (2) and TCNT0 at the
+ * moment of event, i.e. time with 2 ms + 8 us resolution (at 1MHz), so
+ * recording is a few stores with interrupts disabled and may be done from
+ * any interrupt. The tick may be one behind TCNT0, if systick interrupt is
+ * pending at that moment.
+ *  flightrec_freeze() stops recording (e.g. on game over), so the events,
+ * which led to the problem, are kept until flightrec_unfreeze().
+ * flightrec_dump() sends the ring as TM_MSG_FLIGHTREC frames, oldest first,
+ * and tools/flightrec_decode.py reconstructs a timeline from them.
+ *  uart.h, telemetry.h and systick.h must be included before this file.
+ *  Optional macros:
+ *  FLIGHTREC_SIZE -- number of records, must be a power of 2, default is 16
+ */
+
+#ifndef FLIGHTREC_H_
+#define FLIGHTREC_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "decls.h"
+#include "systick.h"
+
+#ifndef FLIGHTREC_SIZE
+#define FLIGHTREC_SIZE 16
+#endif // FLIGHTREC_SIZE
+
+#define FLIGHTREC_RECORD_SIZE 5
+#define FLIGHTREC_RECORDS_PER_FRAME ((TELEMETRY_MAX_PAYLOAD - 1) / FLIGHTREC_RECORD_SIZE)
+
+typedef struct {
+	byte_t type; // flightrec_event_t
+	byte_t arg;
+	uint16_t ticks; // _systick_ticks
+	byte_t counter; // TCNT0
+} flightrec_record_t;
+
+static flightrec_record_t _flightrec_ring[FLIGHTREC_SIZE];
+static volatile byte_t _flightrec_pos; // where the next record is written
+static volatile byte_t _flightrec_count;
+static volatile bool_t _flightrec_frozen;
+
+static inline void flightrec_event(uint8_t type, uint8_t arg)
+{
+	byte_t sreg = SREG;
+	cli();
+	if (!_flightrec_frozen) {
+		flightrec_record_t *rec = &_flightrec_ring[_flightrec_pos];
+		rec->type = type;
+		rec->arg = arg;
+		rec->ticks = _systick_ticks;
+		rec->counter = TCNT0;
+		_flightrec_pos = (_flightrec_pos + 1) & (FLIGHTREC_SIZE - 1);
+		if (_flightrec_count < FLIGHTREC_SIZE)
+			++_flightrec_count;
+	}
+	SREG = sreg;
+}
+
+/* stops recording */
+void flightrec_freeze() { _flightrec_frozen = true; }
+
+/* clears the ring and continues recording */
+void flightrec_unfreeze()
+{
+	byte_t sreg = SREG;
+	cli();
+	_flightrec_pos = _flightrec_count = 0;
+	_flightrec_frozen = false;
+	SREG = sreg;
+}
+
+bool_t flightrec_is_frozen() { return _flightrec_frozen; }
+
+/*  Sends all records, waiting for space in tx buffer, so must be called
+ * with interrupts enabled and not from interrupts. Ring is frozen meanwhile,
+ * so it is consistent, and stays frozen, if it was */
+void flightrec_dump()
+{
+	bool_t was_frozen = _flightrec_frozen;
+	_flightrec_frozen = true;
+
+	byte_t count = _flightrec_count;
+	byte_t pos = (_flightrec_pos - count) & (FLIGHTREC_SIZE - 1);
+	for (byte_t first = 0; first < count; first += FLIGHTREC_RECORDS_PER_FRAME) {
+		byte_t payload[1 + FLIGHTREC_RECORDS_PER_FRAME * FLIGHTREC_RECORD_SIZE];
+		byte_t len = 0;
+
+		payload[len++] = first; // record number, 0 is the oldest
+		for (byte_t i = first; i < count && i < first + FLIGHTREC_RECORDS_PER_FRAME; ++i) {
+			const flightrec_record_t *rec = &_flightrec_ring[pos];
+			payload[len++] = rec->type;
+			payload[len++] = rec->arg;
+			payload[len++] = rec->ticks;
+			payload[len++] = rec->ticks >> 8;
+			payload[len++] = rec->counter;
+			pos = (pos + 1) & (FLIGHTREC_SIZE - 1);
+		}
+		while (uart_tx_free() < len + TELEMETRY_OVERHEAD)
+			;
+		telemetry_send(TM_MSG_FLIGHTREC, payload, len);
+	}
+
+	/* frame without records marks the end, it has the number of records */
+	while (uart_tx_free() < 1 + TELEMETRY_OVERHEAD)
+		;
+	telemetry_send(TM_MSG_FLIGHTREC, &count, 1);
+	_flightrec_frozen = was_frozen;
+}
+
+#endif // FLIGHTREC_H_
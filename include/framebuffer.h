@@ -0,0 +1,77 @@
+/* Double-buffered frame for max7219
+ *
+ *  Producers (main loop or interrupts) draw into the back page, then
+ * framebuffer_flip() makes it the front page at once: a few cycles with
+ * interrupts disabled, nobody waits for SPI. framebuffer_flush() is the only
+ * place, which sends frames: it sends changed rows of the front page, if there
+ * was a flip since the previous flush. It should be called from a periodic
+ * interrupt (e.g. systick callback), so a frame appears within one period
+ * and always as a whole. If flip is done with interrupts disabled, the
+ * frame is flushed right away, because the interrupt can't come.
+ *  Only one producer may draw at a time. Frames which were flipped before
+ * the previous one was flushed are skipped.
+ *  Other max7219 writes from the main loop (intensity, shutdown) must be done
+ * with interrupts disabled, flush may come in the middle of a packet. Don't
+ * draw or flip while greyscale.h is running: it keeps its planes in the pages
+ * and sends its own frames.
+ *  Included by drawing.h, if DRAWING_USING_FRAMEBUFFER is defined, then
+ * image_show_max7219() and image_show_packed_max7219() go through it.
+ * Back page is drawn as the picture, it is transformed according to
+ * DISPLAY_ORIENTATION (see orient.h) on flip, before it becomes front
+ */
+
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "decls.h"
+#include "max7219.h"
+
+static image_t _framebuffer_pages[2];
+static volatile byte_t _framebuffer_front; // index of page, which is shown
+static volatile bool_t _framebuffer_pending; // front page wasn't sent yet
+
+/* contents are undefined, draw the whole frame */
+image_ref_t framebuffer_back() { return _framebuffer_pages[_framebuffer_front ^ 1]; }
+
+/*  Sends changed rows of the front page, if it was flipped since the
+ * previous call. Must be called with interrupts disabled.
+ * Returns number of sent rows */
+byte_t framebuffer_flush()
+{
+	if (!_framebuffer_pending)
+		return 0;
+	_framebuffer_pending = false;
+
+	const byte_t *front = _framebuffer_pages[_framebuffer_front];
+	byte_t nsent = 0;
+	for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i)
+		nsent += max7219_update_digit(i, front[i]);
+	FLIGHTREC_EVENT(FR_FLUSH, nsent);
+	return nsent;
+}
+
+/* back page becomes front, may be called from interrupts */
+void framebuffer_flip()
+{
+	orient_image(framebuffer_back(), DISPLAY_ORIENTATION); // back page isn't shared
+	byte_t sreg = SREG;
+	cli();
+	_framebuffer_front ^= 1;
+	_framebuffer_pending = true;
+	if (!(sreg & (1 << SREG_I)))
+		framebuffer_flush();
+	SREG = sreg;
+}
+
+/* copies image to the back page and flips */
+void framebuffer_show(cimage_t image)
+{
+	image_ref_t back = framebuffer_back();
+	for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i)
+		back[i] = image[i];
+	framebuffer_flip();
+}
+
+#endif // FRAMEBUFFER_H_
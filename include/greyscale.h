@@ -0,0 +1,234 @@
+/* Greyscale on 8x8 led matrix with bit-angle modulation
+ *
+ *  max7219 has only on/off pixels, so brightness levels are made in time:
+ * image consists of GREYSCALE_NPLANES bit-planes, plane p is shown for
+ * GREYSCALE_BASE_TICKS << p timer2 ticks, so pixel with level L glows
+ * L / (2^NPLANES - 1) of time. Default is 2 planes, i.e. 4 levels (0 - off,
+ * 3 - full brightness), subframes of 2.56 and 5.12 ms, cycle is 7.68 ms (130 Hz).
+ *  Subframes are switched in TIMER2_COMP_vect, which writes only rows, which
+ * differ from what max7219 already shows (see max7219_update_digit()),
+ * so pixels with levels 0 and max cost nothing.
+ *  While greyscale is running, timer2 is busy and nothing else may write
+ * to max7219 (interrupt may come in the middle of a packet), except with
+ * interrupts disabled. Use greyscale_show() instead of image_show_max7219().
+ * If framebuffer.h is included before and there are at most 2 planes, they
+ * are kept in framebuffer pages, so the frame drawn there is lost on start.
+ * Planes are shown as they are, so DISPLAY_ORIENTATION (see orient.h) is to be
+ * folded in by whoever draws them, or applied with orient_image() per plane.
+ *  Subframe rate and cpu time spent in interrupt are measured with timer2
+ * itself, with precision of GREYSCALE_FREQDIV cycles, see greyscale_get_stats().
+ *  Optional macros:
+ *  GREYSCALE_NPLANES -- from 1 to 3, default is 2
+ *  GREYSCALE_BASE_TICKS -- length of the shortest subframe in units of
+ *   GREYSCALE_FREQDIV cycles, default is 80 for 2 planes and 48 for 3 planes
+ */
+
+#ifndef GREYSCALE_H_
+#define GREYSCALE_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "decls.h"
+#include "drawing.h"
+
+#ifndef GREYSCALE_NPLANES
+#define GREYSCALE_NPLANES 2
+#endif // GREYSCALE_NPLANES
+
+#if GREYSCALE_NPLANES < 1 || GREYSCALE_NPLANES > 3
+#error "GREYSCALE_NPLANES must be from 1 to 3"
+#endif
+
+#ifndef GREYSCALE_BASE_TICKS
+#if GREYSCALE_NPLANES == 3
+#define GREYSCALE_BASE_TICKS 48
+#else
+#define GREYSCALE_BASE_TICKS 80
+#endif
+#endif // GREYSCALE_BASE_TICKS
+
+#if (GREYSCALE_BASE_TICKS << (GREYSCALE_NPLANES - 1)) > 256
+#error "the longest subframe doesn't fit into timer2"
+#endif
+
+#define GREYSCALE_FREQDIV 32
+#define GREYSCALE_FREQDIV_MASK ((1 << CS21) | (1 << CS20))
+#define GREYSCALE_MAX_LEVEL ((1 << GREYSCALE_NPLANES) - 1)
+
+typedef byte_t greyscale_image_t[GREYSCALE_NPLANES][MAX_IMAGE_HEIGHT];
+
+typedef struct {
+	uint16_t nsubframes;
+	uint32_t total_ticks; // length of counted subframes
+	uint32_t busy_ticks; // spent in interrupt
+} greyscale_stats_t;
+
+#if defined(FRAMEBUFFER_H_) && GREYSCALE_NPLANES <= 2
+/* pages of framebuffer.h are idle while greyscale is running, so planes
+ * are kept in them: 16 bytes of RAM less */
+#define _greyscale_front _framebuffer_pages
+#else
+static greyscale_image_t _greyscale_front; // read by interrupt
+#endif
+static volatile byte_t _greyscale_plane; // plane, which is shown now
+static volatile greyscale_stats_t _greyscale_stats;
+
+void greyscale_clear(greyscale_image_t image)
+{
+	for (byte_t p = 0; p < GREYSCALE_NPLANES; ++p)
+		for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i)
+			image[p][i] = 0;
+}
+
+/*  i, j are from 0 to 7 (as in image_set_px()),
+ * level is from 0 to GREYSCALE_MAX_LEVEL */
+void greyscale_set_px(greyscale_image_t image, byte_t i, byte_t j, byte_t level)
+{
+	for (byte_t p = 0; p < GREYSCALE_NPLANES; ++p)
+		BIT_SET_TO(image[p][i], j, (level >> p) & 1);
+}
+
+/* pixels, which are set in mask, get level, others are not changed */
+void greyscale_draw_image(greyscale_image_t image, cimage_t mask, byte_t level)
+{
+	for (byte_t p = 0; p < GREYSCALE_NPLANES; ++p)
+		for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i) {
+			if (level & (1 << p))
+				image[p][i] |= mask[i];
+			else
+				image[p][i] &= ~mask[i];
+		}
+}
+
+/*  Only rows, which bits are set in rows mask, are taken from image, e.g.
+ * rows changed by compositor_compose(). They are shown from the next
+ * subframe, may be called from interrupts */
+void greyscale_show_rows(const greyscale_image_t image, byte_t rows)
+{
+	byte_t sreg = SREG;
+	cli();
+	for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i)
+		if (rows & (1 << i))
+			for (byte_t p = 0; p < GREYSCALE_NPLANES; ++p)
+				_greyscale_front[p][i] = image[p][i];
+	SREG = sreg;
+	FLIGHTREC_EVENT(FR_FLUSH, 0); // rows are sent on the next subframes
+}
+
+/* image is shown from the next subframe, may be called from interrupts */
+void greyscale_show(const greyscale_image_t image)
+	{ greyscale_show_rows(image, 0xFF); }
+
+/*  Planes, which are being shown, to be changed in place (e.g. by
+ * compositor_compose()) instead of keeping another image on stack.
+ * Interrupts must be disabled while they are changed, changed rows are
+ * shown from the next subframe */
+byte_t (*greyscale_front())[MAX_IMAGE_HEIGHT]
+	{ return _greyscale_front; }
+
+/* starts timer2, shown image is not changed, until greyscale_show() is called */
+void greyscale_start()
+{
+	byte_t sreg = SREG;
+	cli();
+	for (byte_t p = 0; p < GREYSCALE_NPLANES; ++p)
+		for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i)
+			_greyscale_front[p][i] = _max7219_digits[i];
+#ifdef FRAMEBUFFER_H_
+	_framebuffer_pending = false; // pages are planes now, don't flush them
+#endif
+	_greyscale_plane = 0;
+	OCR2 = GREYSCALE_BASE_TICKS - 1;
+	TCNT2 = 0;
+	TCCR2 = (1 << WGM21) | GREYSCALE_FREQDIV_MASK; // CTC mode
+	TIFR = 1 << OCF2;
+	TIMSK |= 1 << OCIE2;
+	SREG = sreg;
+}
+
+/*  Stops timer2. Display keeps the current subframe, so show something
+ * with image_show_max7219() afterwards */
+void greyscale_stop()
+{
+	byte_t sreg = SREG;
+	cli();
+	TIMSK &= ~(1 << OCIE2);
+	TCCR2 = 0;
+	SREG = sreg;
+}
+
+void greyscale_get_stats(greyscale_stats_t *stats)
+{
+	byte_t sreg = SREG;
+	cli();
+	stats->nsubframes = _greyscale_stats.nsubframes;
+	stats->total_ticks = _greyscale_stats.total_ticks;
+	stats->busy_ticks = _greyscale_stats.busy_ticks;
+	SREG = sreg;
+}
+
+void greyscale_reset_stats()
+{
+	byte_t sreg = SREG;
+	cli();
+	_greyscale_stats.nsubframes = 0;
+	_greyscale_stats.total_ticks = _greyscale_stats.busy_ticks = 0;
+	SREG = sreg;
+}
+
+uint16_t greyscale_subframes_per_s()
+{
+	greyscale_stats_t stats;
+	greyscale_get_stats(&stats);
+	if (stats.nsubframes == 0)
+		return 0;
+	return (uint32_t) stats.nsubframes * (F_CPU / GREYSCALE_FREQDIV) / stats.total_ticks;
+}
+
+/* share of cpu time spent on switching subframes */
+uint16_t greyscale_cpu_permille()
+{
+	greyscale_stats_t stats;
+	greyscale_get_stats(&stats);
+	if (stats.total_ticks == 0)
+		return 0;
+	return stats.busy_ticks * 1000 / stats.total_ticks;
+}
+
+static inline void _greyscale_next_subframe()
+{
+	/* timer2 was reset to 0 at compare match, so OCR2 may be changed now */
+	byte_t plane = _greyscale_plane;
+	byte_t next = (plane + 1 == GREYSCALE_NPLANES) ? 0 : plane + 1;
+	OCR2 = (GREYSCALE_BASE_TICKS << next) - 1;
+	_greyscale_plane = next;
+
+	for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i)
+		max7219_update_digit(i, _greyscale_front[next][i]);
+
+	/* keeps products with 1000 and F_CPU / GREYSCALE_FREQDIV in 32 bits */
+	if (_greyscale_stats.nsubframes == 0x3FFF) {
+		_greyscale_stats.nsubframes >>= 1;
+		_greyscale_stats.total_ticks >>= 1;
+		_greyscale_stats.busy_ticks >>= 1;
+	}
+	++_greyscale_stats.nsubframes;
+	_greyscale_stats.total_ticks += GREYSCALE_BASE_TICKS << plane;
+	_greyscale_stats.busy_ticks += TCNT2; // ticks since compare match
+}
+
+#ifdef PROFILER_ENABLE
+/* systick samples may land here, see profiler.h */
+ISR(TIMER2_COMP_vect)
+{
+	TIMSK &= ~(1 << OCIE2);
+	sei();
+	_greyscale_next_subframe();
+	cli();
+	TIMSK |= 1 << OCIE2;
+}
+#else
+ISR(TIMER2_COMP_vect) { _greyscale_next_subframe(); }
+#endif // PROFILER_ENABLE
+
+#endif // GREYSCALE_H_
@@ -0,0 +1,67 @@
+/* Obstacle layouts for snake game on 8x8 board
+ *  Layouts are stored in program memory as wall masks (see snake_game.h,
+ * on 8x8 board bit x of byte y is a wall at (x, y)) and are copied into
+ * game->walls with a single memcpy_P by level_load() before
+ * snake_game_init(). Then walls are checked together with the game map,
+ * so they cost nothing extra per tick.
+ *  Layouts are left-right symmetric, so it doesn't matter, that drawing
+ * mirrors x. Cells (3, 0) - (3, 3) must stay free: snake starts at (3, 3)
+ * moving up. Level 0 is the classic empty board.
+ */
+
+#ifndef LEVELS_H_
+#define LEVELS_H_
+
+#include <string.h>
+#include "decls.h"
+#include "snake_game.h"
+
+#if SNAKE_GAME_WIDTH != 8 || SNAKE_GAME_HEIGHT != 8
+#error "levels are drawn for 8x8 board"
+#endif
+
+static const snake_wall_mask_t levels[] PROGMEM = {
+	{ 0 }, // empty
+	{ // corners
+		0b11000011,
+		0b10000001,
+		0b00000000,
+		0b00000000,
+		0b00000000,
+		0b00000000,
+		0b10000001,
+		0b11000011
+	},
+	{ // pillars
+		0b00000000,
+		0b00000000,
+		0b00100100,
+		0b00000000,
+		0b00000000,
+		0b00100100,
+		0b00000000,
+		0b00000000
+	},
+	{ // box with gates in the middle of each side
+		0b11100111,
+		0b10000001,
+		0b10000001,
+		0b00000000,
+		0b00000000,
+		0b10000001,
+		0b10000001,
+		0b11100111
+	}
+};
+
+#define NLEVELS ARR_SZ(levels)
+
+/* unknown levels are loaded as level 0 */
+void level_load(snake_game_t *game, byte_t level)
+{
+	if (level >= NLEVELS)
+		level = 0;
+	memcpy_P(game->walls, levels[level], sizeof game->walls);
+}
+
+#endif // LEVELS_H_
@@ -1,9 +1,32 @@
-/* Small library for using max7219 led driver on atmega8535
- * max7219 is accessed via SPI. Connection is the following:
- *  MAX7219 DIN (pin 1)		--> avr SPI MOSI
- *  MAX7219 LOAD (pin 12)	-->	avr SPI SS
- *  MAX7219 CLK (pin 13)	--> avr SPI SCK
- * SS is used not as a slave selector, but as a pin to write to max7219 LOAD
+/* Small library for using max7219 led driver on avr microcontrollers
+ *  Backend, which shifts packets out, is chosen at compile time with
+ * MAX7219_BACKEND, the rest of interface doesn't depend on it:
+ *  MAX7219_BACKEND_SPI (default) -- hardware SPI, connection is the following:
+ *   MAX7219 DIN (pin 1)	--> avr SPI MOSI
+ *   MAX7219 LOAD (pin 12)	--> avr SPI SS
+ *   MAX7219 CLK (pin 13)	--> avr SPI SCK
+ *  SS is used not as a slave selector, but as a pin to write to max7219 LOAD
+ *  MAX7219_BACKEND_BITBANG -- any three pins of one port, for boards, which
+ *  need SPI pins for something else. The following macros must be defined:
+ *   MAX7219_PORT            -- port, to which max7219 is connected
+ *   MAX7219_PORTDD          -- port for switching MAX7219_PORT mode
+ *   MAX7219_CLK_PIN         -- CLK pin index
+ *   MAX7219_DATA_IN_PIN     -- DATA_IN pin index
+ *   MAX7219_LOAD_PIN        -- LOAD pin index
+ *  Bit-bang packet is fully unrolled: port is read once per packet, then
+ * every bit is two writes of precomputed values (data with CLK low, then
+ * the same with CLK high), which is close to SPI at CK/4 (compare them with
+ * max7219_bench.c). Interrupts are disabled for the packet (~110 cycles),
+ * so interrupt handlers may use other pins of the same port.
+ * Example:
+ *  #define MAX7219_BACKEND MAX7219_BACKEND_BITBANG
+ *  #define MAX7219_PORT PORTA
+ *  #define MAX7219_PORTDD DDRA
+ *  #define MAX7219_CLK_PIN 0
+ *  #define MAX7219_DATA_IN_PIN 1
+ *  #define MAX7219_LOAD_PIN 2
+ *  #include "max7219.h"
+ * Note: before using library, call max7219_init_ports()
  */
 
 #ifndef MAX7219_H_
@@ -13,6 +36,25 @@
 #include <avr/interrupt.h>
 #include "decls.h"
 
+#define MAX7219_BACKEND_SPI		1
+#define MAX7219_BACKEND_BITBANG	2
+
+#ifndef MAX7219_BACKEND
+#define MAX7219_BACKEND MAX7219_BACKEND_SPI
+#endif // MAX7219_BACKEND
+
+#define MAX7219_MODE_DECODE			0x09
+#define MAX7219_MODE_INTENSITY		0x0A
+#define MAX7219_MODE_SCAN_LIMIT		0x0B
+#define MAX7219_MODE_SHUTDOWN		0x0C
+#define MAX7219_MODE_DISPLAY_TEST	0x0F
+#define MAX7219_MODE_NOOP			0x00
+#define MAX7219_DIGIT0				0x01
+
+#if MAX7219_BACKEND == MAX7219_BACKEND_SPI
+
+#define MAX7219_BACKEND_NAME "spi"
+
 /* SPI pins are given for atmega8535 and may differ on other avrs */
 #define SPI_PORT	PORTB
 #define SPI_PORTDD	DDRB
@@ -24,21 +66,13 @@
 #define MAX7219_PORTDD		SPI_PORTDD
 #define MAX7219_LOAD_PIN	SPI_SS
 
-#define MAX7219_MODE_DECODE			0x09
-#define MAX7219_MODE_INTENSITY		0x0A
-#define MAX7219_MODE_SCAN_LIMIT		0x0B
-#define MAX7219_MODE_SHUTDOWN		0x0C
-#define MAX7219_MODE_DISPLAY_TEST	0x0F
-#define MAX7219_MODE_NOOP			0x00
-#define MAX7219_DIGIT0				0x01
-
 /* shifts in next byte into internal max7219 register */
 void _max7219_send_byte(byte_t byte)
 {
 	SPDR = byte;
 	while (!(SPSR & (1 << SPIF)))
 		;
-	SPSR &= ~(1 << SPIF);
+	/* SPIF is cleared by reading SPSR and then accessing SPDR (next byte) */
 }
 
 /* sends 16-bit packet to max7219 */
@@ -47,9 +81,74 @@ void _max7219_send_packet(byte_t register_addr, byte_t data)
 	MAX7219_PORT &= ~(1 << MAX7219_LOAD_PIN); // set LOAD bit = 0
 	_max7219_send_byte(register_addr);
 	_max7219_send_byte(data);
+	(void) SPDR; // clears SPIF after the last byte
 	MAX7219_PORT |= (1 << MAX7219_LOAD_PIN); // set LOAD bit = 1
 }
 
+void max7219_init_ports()
+{
+	/* set pins as outputs */
+	MAX7219_PORTDD |= (1 << SPI_SCK) | (1 << SPI_MOSI) | (1 << MAX7219_LOAD_PIN);
+
+	/* no interrupts, enable SPI, MSB first, master, cpol=0, cpha=0, freq div = CK/4 */
+	SPCR = 0b01010000;
+}
+
+#elif MAX7219_BACKEND == MAX7219_BACKEND_BITBANG
+
+#define MAX7219_BACKEND_NAME "bitbang"
+
+#if !defined(MAX7219_PORT) || !defined(MAX7219_PORTDD) || !defined(MAX7219_CLK_PIN) \
+	|| !defined(MAX7219_DATA_IN_PIN) || !defined(MAX7219_LOAD_PIN)
+#error "MAX7219_PORT, MAX7219_PORTDD and MAX7219_*_PIN must be defined for bit-bang backend"
+#endif
+
+#define _MAX7219_CLK	(1 << MAX7219_CLK_PIN)
+#define _MAX7219_DIN	(1 << MAX7219_DATA_IN_PIN)
+#define _MAX7219_LOAD	(1 << MAX7219_LOAD_PIN)
+
+/*  max7219 latches DIN on rising edge of CLK. low is port value with
+ * CLK, DIN and LOAD = 0, so every bit costs sbrc/ori + two out */
+#define _MAX7219_SEND_BIT(byte, n, low) \
+	do { \
+		byte_t _v = (low); \
+		if ((byte) & (1 << (n))) \
+			_v |= _MAX7219_DIN; \
+		MAX7219_PORT = _v; \
+		MAX7219_PORT = _v | _MAX7219_CLK; \
+	} while (0)
+
+#define _MAX7219_SEND_BYTE(byte, low) \
+	do { \
+		_MAX7219_SEND_BIT(byte, 7, low); _MAX7219_SEND_BIT(byte, 6, low); \
+		_MAX7219_SEND_BIT(byte, 5, low); _MAX7219_SEND_BIT(byte, 4, low); \
+		_MAX7219_SEND_BIT(byte, 3, low); _MAX7219_SEND_BIT(byte, 2, low); \
+		_MAX7219_SEND_BIT(byte, 1, low); _MAX7219_SEND_BIT(byte, 0, low); \
+	} while (0)
+
+/* sends 16-bit packet to max7219 */
+void _max7219_send_packet(byte_t register_addr, byte_t data)
+{
+	byte_t sreg = SREG;
+	cli();
+	byte_t low = MAX7219_PORT & ~(_MAX7219_CLK | _MAX7219_DIN | _MAX7219_LOAD);
+	_MAX7219_SEND_BYTE(register_addr, low); // LOAD = 0 since the first bit
+	_MAX7219_SEND_BYTE(data, low);
+	MAX7219_PORT = low | _MAX7219_LOAD; // rising LOAD latches packet
+	SREG = sreg;
+}
+
+void max7219_init_ports()
+{
+	/* set all pins as 0 before switching them on */
+	MAX7219_PORT &= ~(_MAX7219_CLK | _MAX7219_DIN | _MAX7219_LOAD);
+	MAX7219_PORTDD |= _MAX7219_CLK | _MAX7219_DIN | _MAX7219_LOAD;
+}
+
+#else
+#error "unknown MAX7219_BACKEND"
+#endif // MAX7219_BACKEND
+
 void max7219_enable_display_test(bool_t enable)
 {
 	byte_t data = !!enable;
@@ -80,12 +179,28 @@ void max7219_set_ndigits(byte_t ndigits)
 	_max7219_send_packet(MAX7219_MODE_SCAN_LIMIT, ndigits - 1);
 }
 
+/* copy of digit registers, so unchanged digits are not sent again */
+static byte_t _max7219_digits[8];
+
 /* digit must be between 0 and 7, val is from 0 to 255 */
 void max7219_setdigit(byte_t digit, byte_t val)
 {
+	_max7219_digits[digit] = val;
 	_max7219_send_packet(MAX7219_DIGIT0 + digit, val);
 }
 
+/*  Same as max7219_setdigit(), but sends nothing if digit already has
+ * this value. Returns true if packet was sent. Digits must have been
+ * written with max7219_setdigit() or max7219_clear_digits() once after
+ * power-up, because max7219 registers are undefined then */
+bool_t max7219_update_digit(byte_t digit, byte_t val)
+{
+	if (_max7219_digits[digit] == val)
+		return false;
+	max7219_setdigit(digit, val);
+	return true;
+}
+
 /* writes 0 to all digits */
 void max7219_clear_digits()
 {
@@ -93,13 +208,4 @@ void max7219_clear_digits()
 		max7219_setdigit(i, 0);
 }
 
-void max7219_init_ports()
-{
-	/* set pins as outputs */
-	MAX7219_PORTDD |= (1 << SPI_SCK) | (1 << SPI_MOSI) | (1 << MAX7219_LOAD_PIN);
-
-	/* no interrupts, enable SPI, MSB first, master, cpol=0, cpha=0, freq div = CK/4 */
-	SPCR = 0b01010000;
-}
-
-#endif // MAX7219_H_
\ No newline at end of file
+#endif // MAX7219_H_
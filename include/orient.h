@@ -0,0 +1,128 @@
+/* Orientation of the matrix and controls
+ *
+ *  Orientation is one of 8 symmetries of the square: transposition
+ * (mirror around the top left - bottom right diagonal), then mirroring of
+ * columns (left - right), then mirroring of rows (top - bottom). Here x is a
+ * column from the left (bit 7 - x of image row), y is a row from the top.
+ *  Optional macros:
+ *  DISPLAY_ORIENTATION -- transform, which is applied to pictures before they
+ *   are sent to matrix, e.g. ORIENT_ROT90 for a matrix, which is mounted
+ *   turned by 90 degrees counterclockwise. Default is ORIENT_NORMAL
+ *  Orientation is a compile time constant, so ORIENT_NORMAL costs nothing and
+ * unused kernels are not compiled. Pictures shown with drawing.h are
+ * transformed once per frame by orient_image(): row reordering is free, column
+ * mirroring takes about 100 cycles and transposition (bit matrix transpose by
+ * three steps of delta swaps) about 150 cycles. Code, which builds frames row
+ * by row (e.g. the game), may fold orientation into its loops instead with
+ * ORIENT_SRC_X() and ORIENT_SRC_Y().
+ *  Directions (snake_dir_t values) are transformed with orient_dir(), input
+ * devices are remapped with orient_input_dir(), so they follow
+ * DISPLAY_ORIENTATION.
+ *  Included by drawing.h
+ */
+
+#ifndef ORIENT_H_
+#define ORIENT_H_
+
+#include "decls.h"
+
+#define ORIENT_FLIP_X 1
+#define ORIENT_FLIP_Y 2
+#define ORIENT_TRANSPOSE 4
+
+#define ORIENT_NORMAL 0
+#define ORIENT_ROT90 (ORIENT_TRANSPOSE | ORIENT_FLIP_X) // clockwise
+#define ORIENT_ROT180 (ORIENT_FLIP_X | ORIENT_FLIP_Y)
+#define ORIENT_ROT270 (ORIENT_TRANSPOSE | ORIENT_FLIP_Y)
+#define ORIENT_ANTITRANSPOSE (ORIENT_TRANSPOSE | ORIENT_FLIP_X | ORIENT_FLIP_Y)
+
+#ifndef DISPLAY_ORIENTATION
+#define DISPLAY_ORIENTATION ORIENT_NORMAL
+#endif // DISPLAY_ORIENTATION
+
+#if DISPLAY_ORIENTATION < 0 || DISPLAY_ORIENTATION > 7
+#error "DISPLAY_ORIENTATION must be one of ORIENT_* constants"
+#endif
+
+/* transposition goes first, so flips of the inverse are swapped */
+#define ORIENT_INVERSE(o) (((o) & ORIENT_TRANSPOSE) \
+	? ORIENT_TRANSPOSE | ((o) & ORIENT_FLIP_X) << 1 | ((o) & ORIENT_FLIP_Y) >> 1 : (o))
+
+#define _ORIENT_FX(x, o) (((o) & ORIENT_FLIP_X) ? MAX_IMAGE_WIDTH - 1 - (x) : (x))
+#define _ORIENT_FY(y, o) (((o) & ORIENT_FLIP_Y) ? MAX_IMAGE_HEIGHT - 1 - (y) : (y))
+
+/* where picture point (x, y) is shown */
+#define ORIENT_DST_X(x, y, o) _ORIENT_FX(((o) & ORIENT_TRANSPOSE) ? (y) : (x), o)
+#define ORIENT_DST_Y(x, y, o) _ORIENT_FY(((o) & ORIENT_TRANSPOSE) ? (x) : (y), o)
+
+/* which picture point is shown at (x, y) */
+#define ORIENT_SRC_X(x, y, o) (((o) & ORIENT_TRANSPOSE) ? _ORIENT_FY(y, o) : _ORIENT_FX(x, o))
+#define ORIENT_SRC_Y(x, y, o) (((o) & ORIENT_TRANSPOSE) ? _ORIENT_FX(x, o) : _ORIENT_FY(y, o))
+
+static inline byte_t orient_reverse_bits(byte_t b)
+{
+	b = b << 4 | b >> 4; // swap
+	b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+	return (b & 0xAA) >> 1 | (b & 0x55) << 1;
+}
+
+/*  Swaps bits of row a, selected by mask, with bits of row b, which are
+ * shift columns to the left */
+#define _ORIENT_DELTA_SWAP(a, b, mask, shift) do { \
+	byte_t t = ((a) ^ ((b) >> (shift))) & (mask); \
+	(a) ^= t; \
+	(b) ^= t << (shift); \
+} while (0)
+
+/* in place, 1x1, 2x2 and 4x4 blocks are swapped across the diagonal */
+void _orient_transpose(image_t image)
+{
+	for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; i += 2)
+		_ORIENT_DELTA_SWAP(image[i], image[i + 1], 0x55, 1);
+	for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i)
+		if (!(i & 2))
+			_ORIENT_DELTA_SWAP(image[i], image[i + 2], 0x33, 2);
+	for (byte_t i = 0; i < MAX_IMAGE_HEIGHT / 2; ++i)
+		_ORIENT_DELTA_SWAP(image[i], image[i + 4], 0x0F, 4);
+}
+
+/*  Transforms image in place, orientation is supposed to be a constant.
+ * Transposition is done last, so mirroring of columns before it is done
+ * by reordering of rows (e.g. ORIENT_ROT90 has no bit reversal) */
+static inline void orient_image(image_t image, byte_t orientation)
+{
+	byte_t flips = (orientation & ORIENT_TRANSPOSE) ? ORIENT_INVERSE(orientation) : orientation;
+
+	if (flips & ORIENT_FLIP_Y)
+		for (byte_t i = 0; i < MAX_IMAGE_HEIGHT / 2; ++i) {
+			byte_t row = image[i];
+			image[i] = image[MAX_IMAGE_HEIGHT - 1 - i];
+			image[MAX_IMAGE_HEIGHT - 1 - i] = row;
+		}
+	if (flips & ORIENT_FLIP_X)
+		for (byte_t i = 0; i < MAX_IMAGE_HEIGHT; ++i)
+			image[i] = orient_reverse_bits(image[i]);
+	if (orientation & ORIENT_TRANSPOSE)
+		_orient_transpose(image);
+}
+
+/* direction in the picture -> direction on the matrix, DIR_UNKNOWN stays */
+static inline int8_t orient_dir(int8_t dir, byte_t orientation)
+{
+	if (orientation & ORIENT_TRANSPOSE) // left, right <-> up, down
+		dir = (dir == 1 || dir == -1) ? dir * 2 : dir / 2;
+	if ((orientation & ORIENT_FLIP_X) && (dir == 1 || dir == -1))
+		dir = -dir;
+	if ((orientation & ORIENT_FLIP_Y) && (dir == 2 || dir == -2))
+		dir = -dir;
+	return dir;
+}
+
+/*  Direction of an input device, which maps its directions to directions on
+ * the matrix with mount orientation, -> direction in the picture */
+static inline int8_t orient_input_dir(int8_t dir, byte_t mount)
+{
+	return orient_dir(orient_dir(dir, mount), ORIENT_INVERSE(DISPLAY_ORIENTATION));
+}
+
+#endif // ORIENT_H_
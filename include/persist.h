@@ -0,0 +1,208 @@
+/* Persistent settings and high score in EEPROM
+ *
+ *  Records are written into a ring of PERSIST_NSLOTS slots, each next
+ * write goes to the next slot, so the wear is spread over the whole ring.
+ * Record layout: sequence number (1 byte), settings, crc8 (1 byte).
+ * Crc starts from PERSIST_CRC_SEED, so neither a zeroed nor a blank (0xFF)
+ * slot passes the check.
+ * Sequence numbers grow by one with every write, so on boot the latest
+ * record is the last one before the first break in the sequence. If its crc
+ * is broken (power was lost during writing), previous slots are tried.
+ *
+ *  Writing a byte to EEPROM takes ~8.5 ms, so persist_save() only queues
+ * the record and returns, bytes are written from EE_RDY interrupt.
+ * Unchanged bytes are not rewritten. Global interrupts must be enabled.
+ * persist_load() must be called once before any persist_save().
+ *  Fields of a loaded record, which are out of range (written by other
+ * firmware or received from telemetry), are replaced with defaults.
+ *
+ *  Optional macros:
+ *  PERSIST_EEPROM_BASE -- address of the ring in EEPROM, default is 0
+ *  PERSIST_NSLOTS -- number of slots in ring, default is whole EEPROM
+ *  PERSIST_NLEVELS -- number of levels (see levels.h), level is not checked
+ *    if it isn't defined
+ */
+
+#ifndef PERSIST_H_
+#define PERSIST_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+#include <string.h>
+#include "decls.h"
+#include "snake_common.h"
+
+typedef struct {
+	uint16_t high_score;
+	byte_t intensity; // max7219 intensity, 0 - 15
+	byte_t speed_curve; // snake_speed_curve_t
+	byte_t spawn_mode; // snake_spawn_mode_t
+	byte_t level; // see levels.h
+} persist_settings_t;
+
+typedef struct {
+	byte_t seq;
+	persist_settings_t settings;
+	byte_t crc;
+} persist_record_t;
+
+#ifndef PERSIST_EEPROM_BASE
+#define PERSIST_EEPROM_BASE 0
+#endif // PERSIST_EEPROM_BASE
+
+#ifndef PERSIST_NSLOTS
+#define PERSIST_NSLOTS ((E2END + 1 - PERSIST_EEPROM_BASE) / sizeof(persist_record_t))
+#endif // PERSIST_NSLOTS
+
+#define PERSIST_CRC_SEED 0xA5
+#define PERSIST_SLOT_ADDR(slot) (PERSIST_EEPROM_BASE + (slot) * sizeof(persist_record_t))
+
+/* last record written or being written, interrupt reads it while writing,
+ * so it's changed only when EEPROM is idle or by the interrupt itself */
+static persist_record_t _persist_last;
+static byte_t _persist_last_slot;
+
+/* record waiting for the current one to be finished */
+static persist_record_t _persist_next;
+static volatile bool_t _persist_next_pending;
+
+/* position in _persist_last, which is being written */
+static volatile byte_t _persist_writing_pos;
+static uint16_t _persist_writing_addr;
+
+static byte_t _persist_crc(const persist_record_t *record)
+{
+	const byte_t *data = (const byte_t *) record;
+	byte_t crc = PERSIST_CRC_SEED;
+
+	for (byte_t i = 0; i < sizeof(persist_record_t) - 1; ++i) // all bytes except crc
+		crc = _crc8_ccitt_update(crc, data[i]);
+	return crc;
+}
+
+static bool_t _persist_read_slot(byte_t slot, persist_record_t *record)
+{
+	eeprom_read_block(record, (const void *) PERSIST_SLOT_ADDR(slot), sizeof(persist_record_t));
+	return record->crc == _persist_crc(record);
+}
+
+/* fields out of range are taken from defaults */
+static void _persist_check_settings(persist_settings_t *settings, const persist_settings_t *defaults)
+{
+	if (settings->intensity > 15)
+		settings->intensity = defaults->intensity;
+	if (settings->speed_curve >= SPEED_NCURVES)
+		settings->speed_curve = defaults->speed_curve;
+	if (settings->spawn_mode >= SPAWN_NMODES)
+		settings->spawn_mode = defaults->spawn_mode;
+#ifdef PERSIST_NLEVELS
+	if (settings->level >= PERSIST_NLEVELS)
+		settings->level = defaults->level;
+#endif // PERSIST_NLEVELS
+}
+
+/*  Reads the latest valid record. If there is no one (e.g. EEPROM is
+ * blank), settings are left untouched, so they should be initialized with
+ * defaults beforehand, bad fields of the record get them too.
+ * Returns true if record was found */
+bool_t persist_load(persist_settings_t *settings)
+{
+	byte_t latest = PERSIST_NSLOTS - 1;
+	byte_t prev_seq = eeprom_read_byte((const uint8_t *) PERSIST_SLOT_ADDR(0));
+
+	for (byte_t slot = 1; slot < PERSIST_NSLOTS; ++slot) {
+		byte_t seq = eeprom_read_byte((const uint8_t *) PERSIST_SLOT_ADDR(slot));
+		if (seq != (byte_t) (prev_seq + 1)) {
+			latest = slot - 1;
+			break;
+		}
+		prev_seq = seq;
+	}
+
+	for (byte_t i = 0; i < PERSIST_NSLOTS; ++i) {
+		if (_persist_read_slot(latest, &_persist_last)) {
+			_persist_last_slot = latest;
+			_persist_check_settings(&_persist_last.settings, settings);
+			*settings = _persist_last.settings;
+			return true;
+		}
+		latest = (latest == 0) ? PERSIST_NSLOTS - 1 : latest - 1;
+	}
+
+	/* nothing valid, the first record will go to slot 0 */
+	_persist_last_slot = PERSIST_NSLOTS - 1;
+	_persist_last.seq = 0xFF;
+	_persist_last.settings = *settings;
+	return false;
+}
+
+/* _persist_last is written to the next slot */
+static void _persist_start_writing()
+{
+	_persist_last_slot = (_persist_last_slot + 1) % PERSIST_NSLOTS;
+	_persist_writing_addr = PERSIST_SLOT_ADDR(_persist_last_slot);
+	_persist_writing_pos = 0;
+	EECR |= 1 << EERIE; // interrupt fires immediately if EEPROM is ready
+}
+
+/*  Queues settings for writing, returns immediately. If previous record
+ * is still being written, new one is written after it. Several records
+ * queued during one write are merged into the latest one */
+void persist_save(const persist_settings_t *settings)
+{
+	byte_t sreg = SREG;
+	cli();
+
+	const persist_record_t *prev = _persist_next_pending ? &_persist_next : &_persist_last;
+	if (memcmp(&prev->settings, settings, sizeof(persist_settings_t)) == 0) {
+		SREG = sreg;
+		return;
+	}
+
+	persist_record_t *record = (EECR & (1 << EERIE)) ? &_persist_next : &_persist_last;
+	record->seq = _persist_last.seq + 1; // merged records share one number
+	record->settings = *settings;
+	record->crc = _persist_crc(record);
+
+	if (record == &_persist_next)
+		_persist_next_pending = true;
+	else
+		_persist_start_writing();
+	SREG = sreg;
+}
+
+/* true while there are unwritten records */
+bool_t persist_is_busy()
+	{ return !!(EECR & (1 << EERIE)); }
+
+ISR(EE_RDY_vect)
+{
+	const byte_t *data = (const byte_t *) &_persist_last;
+
+	/* skip bytes which are already there */
+	while (_persist_writing_pos < sizeof(persist_record_t)) {
+		EEAR = _persist_writing_addr + _persist_writing_pos;
+		EECR |= 1 << EERE;
+		if (EEDR != data[_persist_writing_pos])
+			break;
+		++_persist_writing_pos;
+	}
+
+	if (_persist_writing_pos < sizeof(persist_record_t)) {
+		EEDR = data[_persist_writing_pos++];
+		EECR |= 1 << EEMWE;
+		EECR |= 1 << EEWE; // must follow EEMWE within 4 cycles
+		return;
+	}
+
+	if (_persist_next_pending) {
+		_persist_next_pending = false;
+		_persist_last = _persist_next;
+		_persist_start_writing();
+	} else
+		EECR &= ~(1 << EERIE);
+}
+
+#endif // PERSIST_H_
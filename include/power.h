@@ -0,0 +1,201 @@
+/* Power management: sleeping between interrupts, standby mode
+ * and duty-cycle statistics
+ *
+ *  Everything that happens in the game is caused by an interrupt
+ * (timer1 ticks, adc conversions), so the cpu may sleep in between.
+ * power_idle() chooses the deepest sleep mode which still keeps all
+ * active wake-up sources running:
+ *  - SLEEP_MODE_ADC (adc noise reduction), if an adc conversion is in progress
+ *    and no other peripheral clocked from clkIO has interrupts enabled
+ *  - SLEEP_MODE_IDLE otherwise
+ * clkIO sources are timers 0 and 1, timer2 unless it is asynchronous, uart
+ * and spi. So during the game (systick, timer1 ticks, greyscale on timer2,
+ * uart rx) the cpu idles, adc noise reduction needs all of them off:
+ * power_idle_conversions() waits by counting adc conversions instead of
+ * timer1, e.g. main.c does so in attract mode with systick stopped and uart
+ * receiver switched off. Sleeps in adc noise reduction are counted apart.
+ *
+ *  Duty-cycle statistics are collected by sampling: power_account_sample()
+ * is called from ADC_vect (see async_joystick.h), which fires at a fixed rate
+ * (one conversion is 13 adc clocks = 1664 cpu clocks with freq div 128),
+ * independently of what the cpu is doing. Average current may be estimated as
+ *  I = duty * I_active + (1 - duty) * I_idle
+ *
+ * Note. POWER_STANDBY_POLL may be defined as one of WDTO_xxx constants to
+ *  change how often the button is polled in standby. Default is WDTO_1S
+ */
+
+#ifndef POWER_H_
+#define POWER_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include "decls.h"
+#include "max7219.h"
+
+#ifndef POWER_STANDBY_POLL
+#define POWER_STANDBY_POLL WDTO_1S
+#endif // POWER_STANDBY_POLL
+
+/* written to .noinit memory before power-down, so after watchdog reset
+ * we can distinguish standby polling from a real power-up */
+#define POWER_STANDBY_MAGIC 0x5AA5
+
+typedef struct {
+	uint16_t nawake; // samples taken while cpu was running
+	uint16_t nasleep; // samples taken while cpu was sleeping
+	uint16_t nsleeps; // number of times cpu went to sleep
+	uint16_t nsleeps_adc; // of them in adc noise reduction mode
+} power_stats_t;
+
+static volatile bool_t _power_sleeping;
+static volatile byte_t _power_nconversions; // adc conversions, wraps around
+static volatile power_stats_t _power_stats;
+static uint16_t _power_standby_magic __attribute__((section(".noinit")));
+
+/*  Returns true if peripherals, which are stopped in adc noise reduction mode,
+ * may wake us up (i.e. their interrupts are enabled). Timer2 keeps counting
+ * in asynchronous mode, from its own crystal */
+static bool_t _power_clkio_is_busy()
+{
+	byte_t timers = TIMSK;
+	if (ASSR & (1 << AS2))
+		timers &= ~(1 << OCIE2 | 1 << TOIE2);
+	return timers != 0
+		|| (UCSRB & (1 << RXCIE | 1 << TXCIE | 1 << UDRIE))
+		|| (SPCR & (1 << SPIE));
+}
+
+/*  Sleeps until the next interrupt.
+ *  Must be called with interrupts disabled: check your wake-up condition
+ * under cli() first, otherwise an interrupt may come between the check and
+ * sleep_cpu() and we will sleep until the next one. Returns with interrupts
+ * enabled (sei and sleep are executed atomically) */
+void power_idle()
+{
+	if ((ADCSRA & (1 << ADSC)) && !_power_clkio_is_busy()) {
+		set_sleep_mode(SLEEP_MODE_ADC);
+		++_power_stats.nsleeps_adc;
+	} else
+		set_sleep_mode(SLEEP_MODE_IDLE);
+
+	++_power_stats.nsleeps;
+	_power_sleeping = true;
+	sleep_enable();
+	sei();
+	sleep_cpu();
+	sleep_disable();
+	_power_sleeping = false;
+}
+
+/*  Sleeps until flag becomes true. Flag must be set from an interrupt.
+ * Global interrupts must be enabled */
+void power_idle_until(volatile bool_t *flag)
+{
+	for (;;) {
+		cli();
+		if (*flag)
+			break;
+		power_idle();
+	}
+	sei();
+}
+
+/*  Sleeps during n adc conversions (adc must be converting continuously,
+ * see async_joystick.h), so nothing clocked from clkIO is needed for waiting.
+ * Global interrupts must be enabled */
+void power_idle_conversions(byte_t n)
+{
+	byte_t start = _power_nconversions;
+	for (;;) {
+		cli();
+		if ((byte_t) (_power_nconversions - start) >= n)
+			break;
+		power_idle();
+	}
+	sei();
+}
+
+/*  Called from an interrupt, which fires regularly regardless of cpu state.
+ *  Counters are halved when one of them saturates, so the ratio
+ * reflects recent activity and never overflows */
+static inline void power_account_sample()
+{
+	++_power_nconversions;
+	if (_power_sleeping)
+		++_power_stats.nasleep;
+	else
+		++_power_stats.nawake;
+
+	if (_power_stats.nasleep == 0xFFFF || _power_stats.nawake == 0xFFFF) {
+		_power_stats.nasleep >>= 1;
+		_power_stats.nawake >>= 1;
+	}
+}
+
+void power_get_stats(power_stats_t *stats)
+{
+	byte_t sreg = SREG;
+	cli();
+	stats->nawake = _power_stats.nawake;
+	stats->nasleep = _power_stats.nasleep;
+	stats->nsleeps = _power_stats.nsleeps;
+	stats->nsleeps_adc = _power_stats.nsleeps_adc;
+	SREG = sreg;
+}
+
+void power_reset_stats()
+{
+	byte_t sreg = SREG;
+	cli();
+	_power_stats.nawake = _power_stats.nasleep = _power_stats.nsleeps = _power_stats.nsleeps_adc = 0;
+	SREG = sreg;
+}
+
+/* share of time cpu was running, from 0 to 1000 */
+uint16_t power_duty_permille()
+{
+	power_stats_t stats;
+	power_get_stats(&stats);
+
+	uint32_t total = (uint32_t) stats.nawake + stats.nasleep;
+	if (total == 0)
+		return 1000;
+	return (uint32_t) stats.nawake * 1000 / total;
+}
+
+/*  Shuts down display and adc and puts mcu into power-down mode. Never returns.
+ *  Power-down may be left only by an external interrupt or by reset, and
+ * the button is not wired to INT0..INT2, so the watchdog is used as a wake-up
+ * timer: it resets mcu every POWER_STANDBY_POLL, then main() should call
+ * power_is_standby_wakeup() and either look at the button or
+ * call power_standby() again */
+void power_standby()
+{
+	cli();
+	max7219_enable_shutdown(true);
+	ADCSRA = 0; // adc consumes current even in power-down, if enabled
+
+	_power_standby_magic = POWER_STANDBY_MAGIC;
+	wdt_enable(POWER_STANDBY_POLL);
+	set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+	sleep_enable();
+	for (;;)
+		sleep_cpu();
+}
+
+/*  Must be called at the very beginning of main(). Returns true,
+ * if mcu was reset by the watchdog during standby */
+bool_t power_is_standby_wakeup()
+{
+	bool_t res = (MCUCSR & (1 << WDRF)) && _power_standby_magic == POWER_STANDBY_MAGIC;
+
+	MCUCSR &= ~(1 << WDRF);
+	wdt_disable();
+	_power_standby_magic = 0;
+	return res;
+}
+
+#endif // POWER_H_
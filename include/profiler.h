@@ -0,0 +1,162 @@
+/* Statistical profiler: histogram of interrupted program addresses
+ *
+ *  All timers are busy (timer0 - systick, timer1 - game, timer2 - greyscale),
+ * so samples are taken on systick: with PROFILER_ENABLE defined before any
+ * include, TIMER0_COMP_vect is a naked stub here, which reads the return
+ * address off the stack before anything else is pushed, then jumps to the
+ * usual handler. Address goes into one of PROFILER_NBUCKETS one-byte counters,
+ * bucket covers 2^PROFILER_SHIFT bytes of flash starting from PROFILER_LOW.
+ * When a counter reaches 255, all counters are halved, so proportions are kept.
+ *  Samples are taken every PROFILER_DIVIDER systick ticks (every 2 ms by
+ * default). Sample can't land in an interrupt, which runs with interrupts
+ * disabled, so the heavy ones are made interruptible in the profiling build:
+ * systick callback (buttons, framebuffer_flush()) runs after sei(), a tick,
+ * which comes during it, is sampled and counted, but doesn't call it again,
+ * and greyscale.h switches subframes with its own interrupt masked and the
+ * others enabled. Time spent in the remaining ones (uart, ADC, timer1 game
+ * update, EEPROM) is still attributed to the code, which runs after them.
+ * Nested interrupts need more stack. Sleeping cpu is seen in power_idle().
+ *  profiler_dump() sends the histogram as TM_MSG_PROFILE frames,
+ * tools/profiler_dump.py symbolizes buckets against the elf (main.bin) and prints
+ * a flat profile. To look closer at a hot range, set PROFILER_LOW and a smaller
+ * PROFILER_SHIFT, addresses outside are only counted.
+ *  uart.h, telemetry.h and systick.h must be included before this file.
+ *  Optional macros:
+ *  PROFILER_NBUCKETS -- default is 32 (one byte of RAM each), at most 254
+ *  PROFILER_SHIFT -- default is 8 (256 bytes per bucket, 8KB in 32 buckets)
+ *  PROFILER_LOW -- byte address of the first bucket, default is 0
+ *  PROFILER_DIVIDER -- default is 1
+ */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "decls.h"
+#include "systick.h"
+
+#ifndef PROFILER_ENABLE
+#error "define PROFILER_ENABLE before including anything"
+#endif
+
+#ifndef PROFILER_NBUCKETS
+#define PROFILER_NBUCKETS 32
+#endif // PROFILER_NBUCKETS
+
+#ifndef PROFILER_SHIFT
+#define PROFILER_SHIFT 8
+#endif // PROFILER_SHIFT
+
+#ifndef PROFILER_LOW
+#define PROFILER_LOW 0
+#endif // PROFILER_LOW
+
+#ifndef PROFILER_DIVIDER
+#define PROFILER_DIVIDER 1
+#endif // PROFILER_DIVIDER
+
+#if PROFILER_NBUCKETS > 254
+#error "PROFILER_NBUCKETS must be below 255"
+#endif
+
+#define PROFILER_END_MARKER 0xFF
+
+static volatile byte_t _profiler_buckets[PROFILER_NBUCKETS];
+static volatile byte_t _profiler_outside; // samples outside of buckets
+static byte_t _profiler_countdown;
+volatile uint16_t _profiler_pc; // word address, written by vector stub
+static volatile bool_t _profiler_in_tick; // systick callback runs with interrupts enabled
+
+static void _profiler_halve()
+{
+	for (byte_t i = 0; i < PROFILER_NBUCKETS; ++i)
+		_profiler_buckets[i] >>= 1;
+	_profiler_outside >>= 1;
+}
+
+void _profiler_interrupt(void) __attribute__((signal, used));
+void _profiler_interrupt(void)
+{
+	if (_profiler_countdown == 0) {
+		_profiler_countdown = PROFILER_DIVIDER;
+		uint16_t offset = (_profiler_pc << 1) - PROFILER_LOW; // unsigned, so below is large
+		uint16_t bucket = offset >> PROFILER_SHIFT;
+		volatile byte_t *counter = (bucket < PROFILER_NBUCKETS) ? &_profiler_buckets[bucket] : &_profiler_outside;
+		if (*counter == 0xFF)
+			_profiler_halve();
+		++*counter;
+	}
+	--_profiler_countdown;
+	if (_profiler_in_tick) { // came during the callback of the previous tick
+		++_systick_ticks;
+		return;
+	}
+	_profiler_in_tick = true;
+	sei();
+	_systick_tick();
+	cli();
+	_profiler_in_tick = false;
+}
+
+/*  Return address is on the top of stack: high byte, then low byte (AVR
+ * pushes low byte first). It's read before the compiler saves anything,
+ * r24 and Z are restored before jumping to the real handler */
+ISR(TIMER0_COMP_vect, ISR_NAKED)
+{
+	asm volatile(
+		"push r30\n\t"
+		"push r31\n\t"
+		"in r30, __SP_L__\n\t"
+		"in r31, __SP_H__\n\t"
+		"push r24\n\t"
+		"ldd r24, Z+3\n\t" // Z+1, Z+2 are r31, r30
+		"sts _profiler_pc+1, r24\n\t"
+		"ldd r24, Z+4\n\t"
+		"sts _profiler_pc, r24\n\t"
+		"pop r24\n\t"
+		"pop r31\n\t"
+		"pop r30\n\t"
+		"%~jmp _profiler_interrupt\n\t"
+		::);
+}
+
+void profiler_reset()
+{
+	byte_t sreg = SREG;
+	cli();
+	for (byte_t i = 0; i < PROFILER_NBUCKETS; ++i)
+		_profiler_buckets[i] = 0;
+	_profiler_outside = 0;
+	SREG = sreg;
+}
+
+/*  Sends buckets (see TM_MSG_PROFILE), waiting for space in tx buffer,
+ * so must be called with interrupts enabled and not from interrupts.
+ * Sampling goes on, so counters may be a little inconsistent */
+void profiler_dump()
+{
+	byte_t payload[TELEMETRY_MAX_PAYLOAD];
+
+	for (byte_t first = 0; first < PROFILER_NBUCKETS; first += TELEMETRY_MAX_PAYLOAD - 1) {
+		byte_t len = 0;
+		payload[len++] = first;
+		for (byte_t i = first; i < PROFILER_NBUCKETS && len < TELEMETRY_MAX_PAYLOAD; ++i)
+			payload[len++] = _profiler_buckets[i];
+		while (uart_tx_free() < len + TELEMETRY_OVERHEAD)
+			;
+		telemetry_send(TM_MSG_PROFILE, payload, len);
+	}
+
+	payload[0] = PROFILER_END_MARKER;
+	payload[1] = PROFILER_NBUCKETS;
+	payload[2] = PROFILER_SHIFT;
+	payload[3] = (uint16_t) PROFILER_LOW;
+	payload[4] = (uint16_t) PROFILER_LOW >> 8;
+	payload[5] = _profiler_outside;
+	while (uart_tx_free() < 6 + TELEMETRY_OVERHEAD)
+		;
+	telemetry_send(TM_MSG_PROFILE, payload, 6);
+}
+
+#endif // PROFILER_H_
@@ -0,0 +1,131 @@
+/* Text scroller for 8x8 led matrix
+ *  Text is a plain string (in RAM or in program memory), which moves
+ * from right to left one column per scroller_step(). Glyphs have variable
+ * width (see drawing.h), there is one empty column between them.
+ *  Every step does the same amount of work: all rows of image are shifted
+ * by one and one column of the current glyph is shifted in. The next glyph
+ * is decoded from program memory into a 5-byte buffer once per glyph, so
+ * cost of a step doesn't depend on text length or position and is small
+ * enough to call it from an interrupt next to the game tick.
+ *  If SCROLLER_MEASURE_CYCLES is defined, the longest step (in cpu cycles,
+ * interrupts included) is stored in scroller_max_cycles. Timer1 counts them:
+ * it is borrowed at F_CPU for the step, when no timer1 interrupt is enabled
+ * (e.g. between attract mode frames or draw_effect_scroll() waits), steps
+ * made while a timer1 callback is pending are not measured. Worst case is a
+ * step, which decodes a glyph: about 300 cycles, estimated from the code for
+ * 1 MHz -Os build; main.c reports the measured one in TM_MSG_RENDER.
+ *  DRAWING_USING_NUMBERS or DRAWING_USING_LETTERS must be defined
+ */
+
+#ifndef SCROLLER_H_
+#define SCROLLER_H_
+
+#include <stdlib.h>
+#include <avr/pgmspace.h>
+#include "decls.h"
+#include "drawing.h"
+
+#ifdef SCROLLER_MEASURE_CYCLES
+uint16_t scroller_max_cycles;
+#endif // SCROLLER_MEASURE_CYCLES
+
+typedef struct {
+	const char *text;
+	bool_t text_in_progmem;
+	byte_t top; // row, where glyphs are drawn
+	byte_t glyph[FONT_HEIGHT]; // rows of current glyph
+	byte_t column; // mask of the next column of current glyph, 0 if glyph is over
+	byte_t nblank; // number of empty columns to shift in before the next glyph
+	char number[11]; // buffer for scroller_start_number(), fits any uint32_t
+} scroller_t;
+
+static void _scroller_start(scroller_t *s, const char *text, bool_t in_progmem, byte_t top)
+{
+	s->text = text;
+	s->text_in_progmem = in_progmem;
+	s->top = top;
+	s->column = 0;
+	s->nblank = 0;
+}
+
+/* text in RAM, must stay alive until scrolling is over. top is from 0 to 3 */
+void scroller_start(scroller_t *s, const char *text, byte_t top)
+	{ _scroller_start(s, text, false, top); }
+
+/* text in program memory */
+void scroller_start_P(scroller_t *s, const char *text, byte_t top)
+	{ _scroller_start(s, text, true, top); }
+
+/* decimal number of any length */
+void scroller_start_number(scroller_t *s, uint32_t number, byte_t top)
+{
+	ultoa(number, s->number, 10);
+	_scroller_start(s, s->number, false, top);
+}
+
+/* loads next glyph, returns false if text is over */
+static bool_t _scroller_next_glyph(scroller_t *s)
+{
+	char c = s->text_in_progmem ? pgm_read_byte(s->text) : *s->text;
+	if (!c)
+		return false;
+	++s->text;
+
+	for (byte_t i = 0; i < FONT_HEIGHT; ++i)
+		s->glyph[i] = 0;
+	byte_t width = image_draw_glyph(s->glyph, c, 0, 0);
+	s->column = width ? 1 << (width - 1) : 0;
+	s->nblank = 1;
+	return true;
+}
+
+/*  Shifts image one column to the left and draws next column of text
+ * at the right border. Returns false, when text is over (nothing is drawn
+ * then, so call it MAX_IMAGE_WIDTH more times to move text out of screen) */
+bool_t scroller_step(scroller_t *s, image_t image)
+{
+#ifdef SCROLLER_MEASURE_CYCLES
+	/* users of timer1 reset TCNT1 and compare flags when they start it */
+	byte_t tccr1b = TCCR1B;
+	bool_t measure = !(TIMSK & (1 << OCIE1A | 1 << OCIE1B | 1 << TOIE1));
+	if (measure) {
+		TCCR1B = 1 << CS10; // normal mode, no prescaling
+		TCNT1 = 0;
+	}
+#endif // SCROLLER_MEASURE_CYCLES
+	bool_t res = true;
+
+	if (!s->column) {
+		if (s->nblank)
+			--s->nblank;
+		else
+			res = _scroller_next_glyph(s);
+	}
+
+	byte_t *row = image;
+	byte_t i = 0;
+	for (; i < s->top; ++i)
+		*row++ <<= 1;
+	for (byte_t j = 0; j < FONT_HEIGHT; ++j, ++i) {
+		*row = *row << 1;
+		if (s->glyph[j] & s->column)
+			*row |= 1;
+		++row;
+	}
+	for (; i < MAX_IMAGE_HEIGHT; ++i)
+		*row++ <<= 1;
+	s->column >>= 1;
+
+#ifdef SCROLLER_MEASURE_CYCLES
+	if (measure) {
+		uint16_t cycles = TCNT1;
+		TCCR1B = tccr1b;
+		TIFR = 1 << OCF1A | 1 << OCF1B | 1 << TOV1; // written ones clear flags
+		if (cycles > scroller_max_cycles)
+			scroller_max_cycles = cycles;
+	}
+#endif // SCROLLER_MEASURE_CYCLES
+	return res;
+}
+
+#endif // SCROLLER_H_
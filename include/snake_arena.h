@@ -0,0 +1,330 @@
+/* Snake game for several snakes on one board
+ *  Same rules as snake_game.h, but all snakes move at once. Board is kept
+ * as bitboards (one bit per cell) of occupied cells, rabbits and walls,
+ * so a tick costs O(number of snakes) whatever the board size is.
+ * Declare the folowing constants before including this file:
+ * SNAKE_ARENA_WIDTH
+ * SNAKE_ARENA_HEIGHT
+ * SNAKE_ARENA_MAX_SNAKES -- from 1 to 255
+ * SNAKE_ARENA_MAX_LENGTH -- of every snake
+ *  Optional macros:
+ * SNAKE_ARENA_NO_WRAP -- snakes die at borders instead of appearing
+ *  on the opposite side
+ *  Moves are resolved simultaneously:
+ *  - tails of snakes, which don't eat at this tick, leave their cells first,
+ *    so a head may go into a tail, which is moving (also its own)
+ *  - heads, which go into the same cell, all die (so do contenders for
+ *    the same rabbit), as well as two heads, which swap their cells
+ *  - head, which goes into a wall or a body, dies
+ *  - dead snakes are removed from the board after the tick, eaten rabbits
+ *    are respawned at random free cells
+ *  Cells are indexed y * SNAKE_ARENA_WIDTH + x with one byte for boards up to
+ * 255 cells and two bytes for larger ones, neighbours are computed without
+ * tables, so boards may be large on host.
+ */
+
+#ifndef SNAKE_ARENA_H_
+#define SNAKE_ARENA_H_
+
+#include "decls.h"
+#include "snake_common.h"
+
+#define SNAKE_ARENA_NCELLS (SNAKE_ARENA_WIDTH * SNAKE_ARENA_HEIGHT)
+
+#if SNAKE_ARENA_NCELLS < 255
+typedef byte_t arena_cell_t;
+#define ARENA_CELL_NONE 0xFF
+#elif SNAKE_ARENA_NCELLS < 0xFFFF
+typedef uint16_t arena_cell_t;
+#define ARENA_CELL_NONE 0xFFFF
+#else
+#error "board is too large for two-byte cell index"
+#endif
+
+#if SNAKE_ARENA_MAX_SNAKES < 1 || SNAKE_ARENA_MAX_SNAKES > 255
+#error "SNAKE_ARENA_MAX_SNAKES must be from 1 to 255"
+#endif
+
+#define ARENA_CELL(x, y) ((arena_cell_t) ((y) * SNAKE_ARENA_WIDTH + (x)))
+#define ARENA_CELL_X(cell) ((cell) % SNAKE_ARENA_WIDTH)
+#define ARENA_CELL_Y(cell) ((cell) / SNAKE_ARENA_WIDTH)
+
+typedef byte_t arena_bits_t[(SNAKE_ARENA_NCELLS + 7) / 8];
+
+#define ARENA_BIT(bits, cell) (((bits)[(cell) >> 3] >> ((cell) & 7)) & 1)
+#define _ARENA_BIT_SET(bits, cell) ((bits)[(cell) >> 3] |= 1 << ((cell) & 7))
+#define _ARENA_BIT_CLEAR(bits, cell) ((bits)[(cell) >> 3] &= ~(1 << ((cell) & 7)))
+
+typedef enum {
+	ARENA_ALIVE,
+	ARENA_DIED_BORDER, // only with SNAKE_ARENA_NO_WRAP
+	ARENA_DIED_WALL,
+	ARENA_DIED_BODY, // of itself or of another snake
+	ARENA_DIED_HEAD // another head went into the same cell or into this head
+} arena_death_t;
+
+typedef struct {
+/* read-only: */
+	byte_t death; // arena_death_t
+	snake_dir_t dir;
+	unsigned int length; // score
+/* private: */
+	arena_cell_t segments[SNAKE_ARENA_MAX_LENGTH]; // ring, length cells up to head
+	unsigned int head;
+	arena_cell_t next; // new head during update, ARENA_CELL_NONE at border
+	bool_t is_moving; // was alive at the start of update
+	bool_t eats;
+	bool_t grows; // tail stays
+} arena_snake_t;
+
+typedef struct {
+/* public: */
+	uint16_t seed; // state of random generator, may be set before snake_arena_init()
+	arena_bits_t walls; // may be set before snake_arena_init()
+/* read-only: */
+	arena_bits_t occupied; // by snakes
+	arena_bits_t rabbits;
+	byte_t nsnakes, nalive;
+	unsigned int nrabbits;
+	arena_snake_t snakes[SNAKE_ARENA_MAX_SNAKES];
+/* private: */
+	arena_bits_t claimed; // by new heads
+	arena_bits_t contested; // claimed more than once
+	unsigned int nfree; // cells without walls, snakes and rabbits
+} snake_arena_t;
+
+#define _ARENA_RING_NEXT(i) ((i) + 1 == SNAKE_ARENA_MAX_LENGTH ? 0 : (i) + 1)
+
+/* index of tail in ring */
+static unsigned int _snake_arena_tail(const arena_snake_t *s)
+{
+	unsigned int i = s->head + 1 + SNAKE_ARENA_MAX_LENGTH - s->length;
+	return i >= SNAKE_ARENA_MAX_LENGTH ? i - SNAKE_ARENA_MAX_LENGTH : i;
+}
+
+arena_cell_t snake_arena_head(const arena_snake_t *s)
+	{ return s->segments[s->head]; }
+
+/*  Neighbour of cell in direction dir, borders wrap or lead to
+ * ARENA_CELL_NONE with SNAKE_ARENA_NO_WRAP */
+arena_cell_t snake_arena_next_cell(arena_cell_t cell, snake_dir_t dir)
+{
+	switch (dir) {
+	case DIR_UP:
+		if (cell >= SNAKE_ARENA_WIDTH)
+			return cell - SNAKE_ARENA_WIDTH;
+		break;
+	case DIR_DOWN:
+		if (cell < SNAKE_ARENA_NCELLS - SNAKE_ARENA_WIDTH)
+			return cell + SNAKE_ARENA_WIDTH;
+		break;
+	case DIR_LEFT:
+		if (ARENA_CELL_X(cell) > 0)
+			return cell - 1;
+		break;
+	case DIR_RIGHT:
+		if (ARENA_CELL_X(cell) < SNAKE_ARENA_WIDTH - 1)
+			return cell + 1;
+		break;
+	default:
+		return ARENA_CELL_NONE;
+	}
+#ifdef SNAKE_ARENA_NO_WRAP
+	return ARENA_CELL_NONE;
+#else
+	switch (dir) {
+	case DIR_UP: return cell + SNAKE_ARENA_NCELLS - SNAKE_ARENA_WIDTH;
+	case DIR_DOWN: return cell - (SNAKE_ARENA_NCELLS - SNAKE_ARENA_WIDTH);
+	case DIR_LEFT: return cell + SNAKE_ARENA_WIDTH - 1;
+	default: return cell - (SNAKE_ARENA_WIDTH - 1);
+	}
+#endif // SNAKE_ARENA_NO_WRAP
+}
+
+/* cell has neither snake, nor rabbit, nor wall */
+#define ARENA_CELL_IS_FREE(arena, cell) \
+	(!ARENA_BIT((arena)->occupied, cell) && !ARENA_BIT((arena)->rabbits, cell) \
+		&& !ARENA_BIT((arena)->walls, cell))
+
+/*  Random free cell: a few random tries, then the first free cell after
+ * a random one. Returns ARENA_CELL_NONE if there are no free cells */
+arena_cell_t snake_arena_random_free_cell(snake_arena_t *a)
+{
+	if (a->nfree == 0)
+		return ARENA_CELL_NONE;
+
+	arena_cell_t cell = 0;
+	for (byte_t i = 0; i < 8; ++i) {
+		cell = snake_random(&a->seed) % SNAKE_ARENA_NCELLS;
+		if (ARENA_CELL_IS_FREE(a, cell))
+			return cell;
+	}
+	while (!ARENA_CELL_IS_FREE(a, cell))
+		if (++cell == SNAKE_ARENA_NCELLS)
+			cell = 0;
+	return cell;
+}
+
+static void _snake_arena_spawn_rabbit(snake_arena_t *a)
+{
+	arena_cell_t cell = snake_arena_random_free_cell(a);
+	if (cell == ARENA_CELL_NONE)
+		return;
+	_ARENA_BIT_SET(a->rabbits, cell);
+	++a->nrabbits;
+	--a->nfree;
+}
+
+/*  nsnakes from 1 to SNAKE_ARENA_MAX_SNAKES start one cell long moving up,
+ * spread evenly over the board (or at the next free cells, if there are walls),
+ * nrabbits are put at random cells.
+ * walls and seed should be set beforehand */
+void snake_arena_init(snake_arena_t *a, byte_t nsnakes, unsigned int nrabbits)
+{
+	a->nfree = 0;
+	for (arena_cell_t cell = 0; cell < SNAKE_ARENA_NCELLS; ++cell)
+		a->nfree += !ARENA_BIT(a->walls, cell);
+	for (unsigned int i = 0; i < sizeof(arena_bits_t); ++i)
+		a->occupied[i] = a->rabbits[i] = a->claimed[i] = a->contested[i] = 0;
+	if (a->seed == 0)
+		a->seed = 1;
+
+	/* snakes start in the middles of cells of ncols x nrows grid */
+	byte_t ncols = 1;
+	while (ncols * ncols < nsnakes)
+		++ncols;
+	byte_t nrows = (nsnakes + ncols - 1) / ncols;
+
+	a->nsnakes = a->nalive = 0;
+	a->nrabbits = 0;
+	for (byte_t i = 0; i < nsnakes && a->nfree > 0; ++i) {
+		arena_snake_t *s = &a->snakes[i];
+		arena_cell_t cell = ARENA_CELL((uint32_t) SNAKE_ARENA_WIDTH * (2 * (i % ncols) + 1) / (2 * ncols),
+			(uint32_t) SNAKE_ARENA_HEIGHT * (2 * (i / ncols) + 1) / (2 * nrows));
+		while (!ARENA_CELL_IS_FREE(a, cell))
+			if (++cell == SNAKE_ARENA_NCELLS)
+				cell = 0;
+
+		s->death = ARENA_ALIVE;
+		s->dir = DIR_UP;
+		s->length = 1;
+		s->head = 0;
+		s->segments[0] = cell;
+		_ARENA_BIT_SET(a->occupied, cell);
+		--a->nfree;
+		++a->nsnakes;
+		++a->nalive;
+	}
+	for (unsigned int i = 0; i < nrabbits; ++i)
+		_snake_arena_spawn_rabbit(a);
+}
+
+bool_t snake_arena_is_finished(const snake_arena_t *a) { return a->nalive == 0; }
+
+static void _snake_arena_remove(snake_arena_t *a, arena_snake_t *s)
+{
+	unsigned int i = _snake_arena_tail(s);
+	for (unsigned int n = 0; n < s->length; ++n, i = _ARENA_RING_NEXT(i))
+		_ARENA_BIT_CLEAR(a->occupied, s->segments[i]);
+	a->nfree += s->length;
+	--a->nalive;
+}
+
+/*  Moving snake s and another one go into heads of each other. Someone must
+ * go into the head of s, which is rare, so other snakes are searched only then */
+static bool_t _snake_arena_is_swap(const snake_arena_t *a, const arena_snake_t *s)
+{
+	arena_cell_t head = snake_arena_head(s);
+	if (!ARENA_BIT(a->claimed, head))
+		return false;
+	const arena_snake_t *end = a->snakes + a->nsnakes;
+	for (const arena_snake_t *t = a->snakes; t != end; ++t)
+		if (t != s && t->is_moving && t->next == head && snake_arena_head(t) == s->next)
+			return true;
+	return false;
+}
+
+/*  Moves all alive snakes, dirs[i] is the next direction of snake i
+ * (DIR_UNKNOWN keeps direction). Snake of SNAKE_ARENA_MAX_LENGTH eats,
+ * but doesn't grow */
+void snake_arena_update(snake_arena_t *a, const snake_dir_t *dirs)
+{
+	arena_snake_t *s;
+	arena_snake_t *end = a->snakes + a->nsnakes;
+	unsigned int neaten = 0;
+
+	/* new heads claim cells, cells claimed twice are contested */
+	for (s = a->snakes; s != end; ++s) {
+		s->is_moving = s->death == ARENA_ALIVE;
+		if (!s->is_moving)
+			continue;
+
+		snake_dir_t dir = dirs[s - a->snakes];
+		if (dir != DIR_UNKNOWN && dir != -s->dir) // opposite dirs have opposite values
+			s->dir = dir;
+		s->next = snake_arena_next_cell(snake_arena_head(s), s->dir);
+		if (s->next == ARENA_CELL_NONE)
+			s->death = ARENA_DIED_BORDER;
+		else if (ARENA_BIT(a->claimed, s->next))
+			_ARENA_BIT_SET(a->contested, s->next);
+		else
+			_ARENA_BIT_SET(a->claimed, s->next);
+	}
+
+	/* tails leave their cells, unless snakes grow */
+	for (s = a->snakes; s != end; ++s) {
+		if (!s->is_moving)
+			continue;
+		s->eats = s->next != ARENA_CELL_NONE && ARENA_BIT(a->rabbits, s->next)
+			&& !ARENA_BIT(a->contested, s->next);
+		s->grows = s->eats && s->length < SNAKE_ARENA_MAX_LENGTH;
+		if (!s->grows) {
+			_ARENA_BIT_CLEAR(a->occupied, s->segments[_snake_arena_tail(s)]);
+			--s->length;
+			++a->nfree;
+		}
+	}
+
+	/* heads die on walls, bodies, in contested cells and when they swap:
+	 * tails of one-cell snakes have left, so they would pass through each other */
+	for (s = a->snakes; s != end; ++s) {
+		if (!s->is_moving || s->next == ARENA_CELL_NONE)
+			continue;
+		if (ARENA_BIT(a->walls, s->next))
+			s->death = ARENA_DIED_WALL;
+		else if (ARENA_BIT(a->contested, s->next) || _snake_arena_is_swap(a, s))
+			s->death = ARENA_DIED_HEAD;
+		else if (ARENA_BIT(a->occupied, s->next))
+			s->death = ARENA_DIED_BODY;
+	}
+
+	/* survivors move, dead snakes are removed, claims are cleared */
+	for (s = a->snakes; s != end; ++s) {
+		if (!s->is_moving)
+			continue;
+		if (s->next != ARENA_CELL_NONE) {
+			_ARENA_BIT_CLEAR(a->claimed, s->next);
+			_ARENA_BIT_CLEAR(a->contested, s->next);
+		}
+		if (s->death != ARENA_ALIVE) {
+			_snake_arena_remove(a, s);
+			s->length += !s->grows; // score before the tick
+			continue;
+		}
+		if (s->eats) { // rabbit cell becomes occupied
+			_ARENA_BIT_CLEAR(a->rabbits, s->next);
+			--a->nrabbits;
+			++neaten;
+		} else
+			--a->nfree;
+		s->head = _ARENA_RING_NEXT(s->head);
+		s->segments[s->head] = s->next;
+		++s->length;
+		_ARENA_BIT_SET(a->occupied, s->next);
+	}
+
+	while (neaten--)
+		_snake_arena_spawn_rabbit(a);
+}
+
+#endif // SNAKE_ARENA_H_
@@ -0,0 +1,61 @@
+/*  Rules, which don't depend on board: directions, speed curves and
+ * random generator. Shared by snake_game.h and snake_arena.h */
+
+#ifndef SNAKE_COMMON_H_
+#define SNAKE_COMMON_H_
+
+#include "decls.h"
+
+typedef enum {
+	DIR_UNKNOWN, DIR_LEFT = -1, DIR_RIGHT = 1, DIR_UP = -2, DIR_DOWN = 2
+} snake_dir_t;
+
+/* where new rabbits appear */
+typedef enum {
+	SPAWN_SPACIOUS, // cell with the largest number of empty neighbours
+	SPAWN_RANDOM, // random empty cell
+	SPAWN_NMODES // number of modes, not a mode
+} snake_spawn_mode_t;
+
+/* speed curves, see snake_score_to_speed() */
+typedef enum {
+	SPEED_CURVE_NORMAL, SPEED_CURVE_FAST, SPEED_CURVE_SLOW,
+	SPEED_NCURVES // number of curves, not a curve
+} snake_speed_curve_t;
+
+/* period of game updates in milliseconds */
+uint16_t snake_score_to_speed(unsigned int score, byte_t speed_curve)
+{
+	uint16_t speed;
+
+	if (score < 3)
+		speed = 500;
+	else if (score < 5)
+		speed = 300;
+	else if (score < 10)
+		speed = 250;
+	else if (score < 15)
+		speed = 200;
+	else if (score < 25)
+		speed = 200 - (score - 15) * 10;
+	else
+		speed = 100;
+
+	switch (speed_curve) {
+	case SPEED_CURVE_FAST: return speed * 2 / 3;
+	case SPEED_CURVE_SLOW: return speed * 3 / 2;
+	default: return speed;
+	}
+}
+
+/* xorshift, state must not be 0 */
+uint16_t snake_random(uint16_t *state)
+{
+	uint16_t x = *state;
+	x ^= x << 7;
+	x ^= x >> 9;
+	x ^= x << 8;
+	return *state = x;
+}
+
+#endif // SNAKE_COMMON_H_
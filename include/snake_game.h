@@ -3,63 +3,214 @@
  * MAX_SNAKE_LENGTH
  * SNAKE_GAME_WIDTH
  * SNAKE_GAME_HEIGHT
+ *  Optional macros:
+ * SNAKE_GAME_NO_WRAP -- snake dies at borders instead of appearing
+ *  on the opposite side
+ * SNAKE_GAME_REWIND_DEPTH -- number of last ticks, which may be undone with
+ *  snake_game_rewind(), default is 0 (no rewind). Every tick costs
+ *  SNAKE_GAME_REWIND_RAM / SNAKE_GAME_REWIND_DEPTH bytes of RAM
+ *  Cells are addressed with one-byte index y * SNAKE_GAME_WIDTH + x, moves
+ * are looked up in a table in program memory (next cell for every cell and
+ * direction), so any board size costs the same. Convert to x, y only for
+ * drawing with SNAKE_CELL_X() and SNAKE_CELL_Y().
+ *  Obstacles are given by game->walls, one bit per cell (bit cell & 7
+ * of byte cell >> 3), see levels.h. Snake starts at (3, 3) moving up,
+ * so keep these cells free.
  */
 
 #ifndef SNAKE_GAME_H_
 #define SNAKE_GAME_H_
 
 #include "decls.h"
+#include "snake_common.h"
 
-typedef struct {
-	unsigned int y, x;
-} coord_t;
+#define SNAKE_NCELLS (SNAKE_GAME_WIDTH * SNAKE_GAME_HEIGHT)
 
-typedef enum {
-	DIR_UNKNOWN, DIR_LEFT = -1, DIR_RIGHT = 1, DIR_UP = -2, DIR_DOWN = 2
-} snake_dir_t;
+#ifndef SNAKE_GAME_REWIND_DEPTH
+#define SNAKE_GAME_REWIND_DEPTH 0
+#endif // SNAKE_GAME_REWIND_DEPTH
+
+#if SNAKE_GAME_REWIND_DEPTH > 255
+#error "SNAKE_GAME_REWIND_DEPTH must be below 256"
+#endif
+
+#if SNAKE_NCELLS > 255
+#error "board is too large for one-byte cell index"
+#endif
+
+typedef byte_t cell_idx_t;
+
+#define SNAKE_CELL_NONE 0xFF // outside of the board
+#define SNAKE_CELL(x, y) ((y) * SNAKE_GAME_WIDTH + (x))
+#define SNAKE_CELL_X(cell) ((cell) % SNAKE_GAME_WIDTH)
+#define SNAKE_CELL_Y(cell) ((cell) / SNAKE_GAME_WIDTH)
+
+/*  Segment ring is longer than the snake by rewind depth, so cells, which
+ * tail left during the last SNAKE_GAME_REWIND_DEPTH ticks, are still there */
+#define SNAKE_RING_SIZE (MAX_SNAKE_LENGTH + SNAKE_GAME_REWIND_DEPTH)
 
 typedef struct {
-	coord_t segments[MAX_SNAKE_LENGTH];
+	cell_idx_t segments[SNAKE_RING_SIZE];
 	snake_dir_t dir;
 	unsigned int tail, head;
 } snake_t;
 
+/*  Rewind delta, one byte per tick: direction before the tick (bits 0-1)
+ * and flags. Everything else is restored from the game itself */
+#define SNAKE_DELTA_ATE 0x04
+#define SNAKE_DELTA_DIED 0x08
+#define SNAKE_DELTA_SIZE 1
+
+#define SNAKE_GAME_REWIND_RAM \
+	(SNAKE_GAME_REWIND_DEPTH * (SNAKE_DELTA_SIZE + sizeof(cell_idx_t)) + 2)
+
 typedef enum {
 	CELL_EMPTY, CELL_SNAKE, CELL_RABBIT
 } cell_t; // type of inhabitant inside a cell in game map
 
-typedef cell_t snake_game_map_t[SNAKE_GAME_HEIGHT][SNAKE_GAME_WIDTH];
+typedef byte_t snake_game_map_t[SNAKE_NCELLS]; // cell_t for every cell
+typedef byte_t snake_wall_mask_t[(SNAKE_NCELLS + 7) / 8];
 
 typedef struct {
 /* public: */
 	bool_t is_finished;
+	byte_t spawn_mode; // snake_spawn_mode_t, may be set before snake_game_init()
+	uint16_t seed; // state of random generator, may be set before snake_game_init()
+	snake_wall_mask_t walls; // obstacles, may be set before snake_game_init()
 /* read-only: */
 	unsigned int score; // current game score (i.e. length of snake)
 	snake_game_map_t map; // can be used to draw the game
 /* private: */
 	snake_t snake;
-	coord_t rabbit;	
+	cell_idx_t rabbit;
+#if SNAKE_GAME_REWIND_DEPTH > 0
+	byte_t deltas[SNAKE_GAME_REWIND_DEPTH];
+	byte_t delta_pos; // where the next delta is written
+	byte_t ndeltas;
+#endif
 } snake_game_t;
 
-#define MAP_ELEM(map, coord) ((map)[(coord.y)][(coord.x)])
+#define MAP_ELEM(map, cell) ((map)[cell])
+#define WALL_ELEM(walls, cell) (((walls)[(cell) >> 3] >> ((cell) & 7)) & 1)
+
+/*  Tables of next cells, [cell][direction index]. Borders either wrap
+ * (for moves) or lead to SNAKE_CELL_NONE (for moves with SNAKE_GAME_NO_WRAP
+ * and for counting neighbours). Rows are generated by the preprocessor,
+ * _SNAKE_REPn(M, base) expands to M(base), ..., M(base + n - 1) */
+#define _SNAKE_DIR_IDX(dir) ((dir) + 2 - ((dir) > 0)) // up, left, right, down -> 0..3
+static const int8_t _snake_dirs[4] PROGMEM = { DIR_UP, DIR_LEFT, DIR_RIGHT, DIR_DOWN };
+
+#define _SNAKE_X(c) ((c) % SNAKE_GAME_WIDTH)
+#define _SNAKE_Y(c) ((c) / SNAKE_GAME_WIDTH)
+#define _SNAKE_NEXT_CELLS(c, wrap) { \
+	_SNAKE_Y(c) > 0 ? (c) - SNAKE_GAME_WIDTH : (wrap) ? (c) + SNAKE_NCELLS - SNAKE_GAME_WIDTH : SNAKE_CELL_NONE, \
+	_SNAKE_X(c) > 0 ? (c) - 1 : (wrap) ? (c) + SNAKE_GAME_WIDTH - 1 : SNAKE_CELL_NONE, \
+	_SNAKE_X(c) < SNAKE_GAME_WIDTH - 1 ? (c) + 1 : (wrap) ? (c) - SNAKE_GAME_WIDTH + 1 : SNAKE_CELL_NONE, \
+	_SNAKE_Y(c) < SNAKE_GAME_HEIGHT - 1 ? (c) + SNAKE_GAME_WIDTH : (wrap) ? (c) - SNAKE_NCELLS + SNAKE_GAME_WIDTH : SNAKE_CELL_NONE \
+}
+#define _SNAKE_WRAPPED(c) _SNAKE_NEXT_CELLS(c, 1),
+#define _SNAKE_WALLED(c) _SNAKE_NEXT_CELLS(c, 0),
+
+#define _SNAKE_REP1(M, n) M(n)
+#define _SNAKE_REP2(M, n) _SNAKE_REP1(M, n) _SNAKE_REP1(M, (n) + 1)
+#define _SNAKE_REP4(M, n) _SNAKE_REP2(M, n) _SNAKE_REP2(M, (n) + 2)
+#define _SNAKE_REP8(M, n) _SNAKE_REP4(M, n) _SNAKE_REP4(M, (n) + 4)
+#define _SNAKE_REP16(M, n) _SNAKE_REP8(M, n) _SNAKE_REP8(M, (n) + 8)
+#define _SNAKE_REP32(M, n) _SNAKE_REP16(M, n) _SNAKE_REP16(M, (n) + 16)
+#define _SNAKE_REP64(M, n) _SNAKE_REP32(M, n) _SNAKE_REP32(M, (n) + 32)
+#define _SNAKE_REP128(M, n) _SNAKE_REP64(M, n) _SNAKE_REP64(M, (n) + 64)
+
+/* every set bit of SNAKE_NCELLS adds a block of rows after higher blocks */
+#define _SNAKE_BLOCK_BASE(bit) (SNAKE_NCELLS & ~((bit) * 2 - 1))
+#define _SNAKE_TABLE(M) \
+	_SNAKE_IF_BIT(128, _SNAKE_REP128(M, _SNAKE_BLOCK_BASE(128))) \
+	_SNAKE_IF_BIT(64, _SNAKE_REP64(M, _SNAKE_BLOCK_BASE(64))) \
+	_SNAKE_IF_BIT(32, _SNAKE_REP32(M, _SNAKE_BLOCK_BASE(32))) \
+	_SNAKE_IF_BIT(16, _SNAKE_REP16(M, _SNAKE_BLOCK_BASE(16))) \
+	_SNAKE_IF_BIT(8, _SNAKE_REP8(M, _SNAKE_BLOCK_BASE(8))) \
+	_SNAKE_IF_BIT(4, _SNAKE_REP4(M, _SNAKE_BLOCK_BASE(4))) \
+	_SNAKE_IF_BIT(2, _SNAKE_REP2(M, _SNAKE_BLOCK_BASE(2))) \
+	_SNAKE_IF_BIT(1, _SNAKE_REP1(M, _SNAKE_BLOCK_BASE(1)))
+
+/*  Preprocessor can't test bits inside a macro, so _SNAKE_BIT_n are defined
+ * below. Rows contain commas, so they are passed as variable arguments */
+#define _SNAKE_IF_BIT(bit, ...) _SNAKE_IF_BIT_(_SNAKE_BIT_##bit, __VA_ARGS__)
+#define _SNAKE_IF_BIT_(set, ...) _SNAKE_IF_BIT__(set, __VA_ARGS__)
+#define _SNAKE_IF_BIT__(set, ...) _SNAKE_IF_##set(__VA_ARGS__)
+#define _SNAKE_IF_0(...)
+#define _SNAKE_IF_1(...) __VA_ARGS__
+
+#if SNAKE_NCELLS & 128
+#define _SNAKE_BIT_128 1
+#else
+#define _SNAKE_BIT_128 0
+#endif
+#if SNAKE_NCELLS & 64
+#define _SNAKE_BIT_64 1
+#else
+#define _SNAKE_BIT_64 0
+#endif
+#if SNAKE_NCELLS & 32
+#define _SNAKE_BIT_32 1
+#else
+#define _SNAKE_BIT_32 0
+#endif
+#if SNAKE_NCELLS & 16
+#define _SNAKE_BIT_16 1
+#else
+#define _SNAKE_BIT_16 0
+#endif
+#if SNAKE_NCELLS & 8
+#define _SNAKE_BIT_8 1
+#else
+#define _SNAKE_BIT_8 0
+#endif
+#if SNAKE_NCELLS & 4
+#define _SNAKE_BIT_4 1
+#else
+#define _SNAKE_BIT_4 0
+#endif
+#if SNAKE_NCELLS & 2
+#define _SNAKE_BIT_2 1
+#else
+#define _SNAKE_BIT_2 0
+#endif
+#if SNAKE_NCELLS & 1
+#define _SNAKE_BIT_1 1
+#else
+#define _SNAKE_BIT_1 0
+#endif
+
+#ifndef SNAKE_GAME_NO_WRAP
+static const cell_idx_t _snake_next_cell_wrapped[SNAKE_NCELLS][4] PROGMEM = {
+	_SNAKE_TABLE(_SNAKE_WRAPPED)
+};
+#endif // SNAKE_GAME_NO_WRAP
+
+static const cell_idx_t _snake_next_cell_walled[SNAKE_NCELLS][4] PROGMEM = {
+	_SNAKE_TABLE(_SNAKE_WALLED)
+};
+
+#define _SNAKE_RING_NEXT(i) ((i) + 1 == SNAKE_RING_SIZE ? 0 : (i) + 1)
+#define _SNAKE_RING_PREV(i) ((i) == 0 ? SNAKE_RING_SIZE - 1 : (i) - 1)
 
 /*  Snake must either have enough space,
  * or it must have size == MAX_SNAKE_LENGTH and snake_pop_segment() must
  * be called before any other operations with snake (the latter feature is used
  * when moving snake of maximal size) */
-void snake_add_segment(snake_t *s, coord_t segment)
+void snake_add_segment(snake_t *s, cell_idx_t segment)
 {
-	s->head = (s->head + 1) % MAX_SNAKE_LENGTH;
+	s->head = _SNAKE_RING_NEXT(s->head);
 	s->segments[s->head] = segment;
 }
 
 /* snake must have at least 2 elements */
 void snake_pop_segment(snake_t *s)
-	{ s->tail = (s->tail + 1) % MAX_SNAKE_LENGTH; }
+	{ s->tail = _SNAKE_RING_NEXT(s->tail); }
 
-void snake_move(snake_t *s, coord_t new_head)
+void snake_move(snake_t *s, cell_idx_t new_head)
 {
-	/* works correctly even if snake size == MAX_SNAKE_LENGTH, see 
+	/* works correctly even if snake size == MAX_SNAKE_LENGTH, see
 	 * comment to snake_add_segment() */
 	snake_add_segment(s, new_head);
 	snake_pop_segment(s);
@@ -74,89 +225,122 @@ snake_dir_t snake_choose_dir(const snake_t *s, snake_dir_t next_dir)
 		? s->dir : next_dir;
 }
 
-/* Returns coord, where snake head will be according to direction, stored in snake */
-coord_t snake_next_head_pos(snake_t *s)
+/*  Returns cell, where snake head will be according to direction, stored in snake
+ *  With SNAKE_GAME_NO_WRAP returns SNAKE_CELL_NONE, if snake goes through a border */
+cell_idx_t snake_next_head_pos(snake_t *s)
 {
-	coord_t new_head = s->segments[s->head];
-
-	switch (s->dir) {
-	case DIR_LEFT: new_head.x = (new_head.x + SNAKE_GAME_WIDTH - 1) % SNAKE_GAME_WIDTH; break;
-	case DIR_RIGHT: new_head.x = (new_head.x + 1) % SNAKE_GAME_WIDTH; break;
-	case DIR_UP: new_head.y = (new_head.y + SNAKE_GAME_HEIGHT - 1) % SNAKE_GAME_HEIGHT; break;
-	case DIR_DOWN: new_head.y = (new_head.y + 1) % SNAKE_GAME_HEIGHT; break;
-	default: /* error */ break;
-	}
-	return new_head;
+	cell_idx_t head = s->segments[s->head];
+#ifdef SNAKE_GAME_NO_WRAP
+	return pgm_read_byte(&_snake_next_cell_walled[head][_SNAKE_DIR_IDX(s->dir)]);
+#else
+	return pgm_read_byte(&_snake_next_cell_wrapped[head][_SNAKE_DIR_IDX(s->dir)]);
+#endif // SNAKE_GAME_NO_WRAP
 }
 
 void snake_clear_game_map(snake_game_map_t map)
 {
-	for (unsigned int y = 0; y < SNAKE_GAME_HEIGHT; ++y)
-		for (unsigned int x = 0; x < SNAKE_GAME_WIDTH; ++x)
-			map[y][x] = CELL_EMPTY;	
+	for (cell_idx_t cell = 0; cell < SNAKE_NCELLS; ++cell)
+		map[cell] = CELL_EMPTY;
 }
 
-void snake_init(snake_t *s, coord_t init_pos)
+void snake_init(snake_t *s, cell_idx_t init_pos)
 {
 	s->dir = DIR_UP;
 	s->segments[0] = init_pos;
 	s->head = s->tail = 0;
 }
 
-int count_empty_neighbours(snake_game_map_t map, unsigned int y, unsigned int x)
+/* cell has neither snake, nor rabbit, nor wall */
+#define SNAKE_CELL_IS_FREE(map, walls, cell) \
+	(MAP_ELEM(map, cell) == CELL_EMPTY && !WALL_ELEM(walls, cell))
+
+/* neighbours across borders are not counted */
+int count_empty_neighbours(snake_game_map_t map, const snake_wall_mask_t walls, cell_idx_t cell)
 {
 	int res = 0;
-	if (map[y][x] != CELL_EMPTY)
+	if (!SNAKE_CELL_IS_FREE(map, walls, cell))
 		return -1;
-	if (y > 0)
-		res += (map[y - 1][x] == CELL_EMPTY);
-	if (y < SNAKE_GAME_HEIGHT - 1)
-		res += (map[y + 1][x] == CELL_EMPTY);
-	if (x > 0)
-		res += (map[y][x - 1] == CELL_EMPTY);
-	if (x < SNAKE_GAME_WIDTH - 1)
-		res += (map[y][x + 1] == CELL_EMPTY);
-	// res *= 4;
-	// res += 8 - ABS(x - 4) - ABS(y - 4);
+	for (byte_t i = 0; i < 4; ++i) {
+		cell_idx_t next = pgm_read_byte(&_snake_next_cell_walled[cell][i]);
+		if (next != SNAKE_CELL_NONE)
+			res += SNAKE_CELL_IS_FREE(map, walls, next);
+	}
 	return res;
 }
 
-#define SNAKE_GET_EMPTY_COORD_NATTEMPTS_ 3
-
-coord_t snake_get_empty_coord(snake_game_map_t map)
+cell_idx_t snake_get_empty_cell(snake_game_map_t map, const snake_wall_mask_t walls)
 {
-	coord_t best_coord;
+	cell_idx_t best_cell = 0;
 	int maxempty = -1;
 
-	for (unsigned int y = 0; y < SNAKE_GAME_HEIGHT; ++y)
-		for (unsigned int x = 0; x < SNAKE_GAME_WIDTH; ++x) {
-			int nempty = count_empty_neighbours(map, y, x);
-			if (nempty > maxempty) {
-				best_coord.y = y;
-				best_coord.x = x;
-				maxempty = nempty;
-			}
+	for (cell_idx_t cell = 0; cell < SNAKE_NCELLS; ++cell) {
+		int nempty = count_empty_neighbours(map, walls, cell);
+		if (nempty > maxempty) {
+			best_cell = cell;
+			maxempty = nempty;
 		}
-	/* cycle should always find at least one empty coord */
-	return best_coord;
+	}
+	/* cycle should always find at least one empty cell */
+	return best_cell;
+}
+
+/* first empty cell starting from random one */
+cell_idx_t snake_get_random_empty_cell(snake_game_map_t map, const snake_wall_mask_t walls,
+	uint16_t *rng_state)
+{
+	cell_idx_t cell = snake_random(rng_state) % SNAKE_NCELLS;
+
+	for (cell_idx_t i = 0; i < SNAKE_NCELLS; ++i) {
+		if (SNAKE_CELL_IS_FREE(map, walls, cell))
+			break;
+		if (++cell == SNAKE_NCELLS)
+			cell = 0;
+	}
+	return cell;
+}
+
+/* puts new rabbit on the map according to game->spawn_mode */
+void snake_spawn_rabbit(snake_game_t *game)
+{
+	if (game->spawn_mode == SPAWN_RANDOM)
+		game->rabbit = snake_get_random_empty_cell(game->map, game->walls, &game->seed);
+	else
+		game->rabbit = snake_get_empty_cell(game->map, game->walls);
+	MAP_ELEM(game->map, game->rabbit) = CELL_RABBIT;
+	FLIGHTREC_EVENT(FR_RABBIT, game->rabbit);
 }
 
 void snake_game_init(snake_game_t *game)
 {
-	coord_t snake_init_pos = {3, 3};
-	
+	cell_idx_t snake_init_pos = SNAKE_CELL(3, 3);
+
 	snake_init(&game->snake, snake_init_pos);
 	snake_clear_game_map(game->map);
 	MAP_ELEM(game->map, snake_init_pos) = CELL_SNAKE;
 
-	coord_t rabbit_init_pos = snake_get_empty_coord(game->map);
-
-	game->rabbit = rabbit_init_pos;
-	MAP_ELEM(game->map, rabbit_init_pos) = CELL_RABBIT;
+	if (game->seed == 0)
+		game->seed = 1;
+	snake_spawn_rabbit(game);
 
 	game->is_finished = false;
 	game->score = 1;
+#if SNAKE_GAME_REWIND_DEPTH > 0
+	game->delta_pos = game->ndeltas = 0;
+#endif
+}
+
+#if SNAKE_GAME_REWIND_DEPTH > 0
+static void _snake_record_delta(snake_game_t *game, snake_dir_t prev_dir, byte_t flags)
+{
+	game->deltas[game->delta_pos] = _SNAKE_DIR_IDX(prev_dir) | flags;
+	if (++game->delta_pos == SNAKE_GAME_REWIND_DEPTH)
+		game->delta_pos = 0;
+	if (game->ndeltas < SNAKE_GAME_REWIND_DEPTH)
+		++game->ndeltas;
 }
+#else
+#define _snake_record_delta(game, prev_dir, flags) ((void) (prev_dir))
+#endif // SNAKE_GAME_REWIND_DEPTH
 
 /* If next_dir == DIR_UNKNOWN, snake continues moving in the same direction */
 void snake_game_update(snake_game_t *game, snake_dir_t next_dir)
@@ -164,26 +348,79 @@ void snake_game_update(snake_game_t *game, snake_dir_t next_dir)
 	if (game->is_finished)
 		return;
 
+	snake_dir_t prev_dir = game->snake.dir;
 	game->snake.dir = snake_choose_dir(&game->snake, next_dir);
-	coord_t new_head = snake_next_head_pos(&game->snake);
+	cell_idx_t new_head = snake_next_head_pos(&game->snake);
 
-	if (new_head.x == game->rabbit.x && new_head.y == game->rabbit.y) { // rabbit collision
-		game->rabbit = snake_get_empty_coord(game->map);
-		MAP_ELEM(game->map, game->rabbit) = CELL_RABBIT;
+#ifdef SNAKE_GAME_NO_WRAP
+	if (new_head == SNAKE_CELL_NONE) { // border collision
+		game->is_finished = true;
+		_snake_record_delta(game, prev_dir, SNAKE_DELTA_DIED);
+		return;
+	}
+#endif // SNAKE_GAME_NO_WRAP
+
+	if (new_head == game->rabbit) { // rabbit collision
+		snake_spawn_rabbit(game);
 		snake_add_segment(&game->snake, new_head);
 		MAP_ELEM(game->map, new_head) = CELL_SNAKE; // rewrites CELL_RABBIT
 		++game->score;
+		_snake_record_delta(game, prev_dir, SNAKE_DELTA_ATE);
 		return;
 	}
-	coord_t tail = game->snake.segments[game->snake.tail];
+	cell_idx_t tail = game->snake.segments[game->snake.tail];
 	MAP_ELEM(game->map, tail) = CELL_EMPTY;
 
-	if (MAP_ELEM(game->map, new_head) != CELL_EMPTY) { // self-collision
+	if (MAP_ELEM(game->map, new_head) != CELL_EMPTY
+		|| WALL_ELEM(game->walls, new_head)) { // self-collision or wall
 		game->is_finished = true;
+		_snake_record_delta(game, prev_dir, SNAKE_DELTA_DIED);
 	} else {
 		snake_move(&game->snake, new_head);
 		MAP_ELEM(game->map, new_head) = CELL_SNAKE;
+		_snake_record_delta(game, prev_dir, 0);
+	}
+}
+
+#if SNAKE_GAME_REWIND_DEPTH > 0
+/* number of ticks, which may be undone */
+byte_t snake_game_rewind_depth(const snake_game_t *game)
+	{ return game->ndeltas; }
+
+/*  Undoes the last tick (including the one, which finished the game).
+ * Costs about the same as snake_game_update(). Returns false if there is
+ * nothing to undo. Random generator is not rewound, so rabbits, which
+ * are spawned again, may appear in other cells */
+bool_t snake_game_rewind(snake_game_t *game)
+{
+	if (game->ndeltas == 0)
+		return false;
+	--game->ndeltas;
+	game->delta_pos = (game->delta_pos == 0) ? SNAKE_GAME_REWIND_DEPTH - 1 : game->delta_pos - 1;
+	byte_t flags = game->deltas[game->delta_pos];
+	snake_t *s = &game->snake;
+
+	s->dir = (int8_t) pgm_read_byte(&_snake_dirs[flags & 0x03]);
+	if (flags & SNAKE_DELTA_DIED) { // snake didn't move, only its tail was erased
+		MAP_ELEM(game->map, s->segments[s->tail]) = CELL_SNAKE;
+		game->is_finished = false;
+		return true;
+	}
+
+	cell_idx_t head = s->segments[s->head];
+	s->head = _SNAKE_RING_PREV(s->head);
+	if (flags & SNAKE_DELTA_ATE) { // put eaten rabbit back
+		MAP_ELEM(game->map, game->rabbit) = CELL_EMPTY;
+		MAP_ELEM(game->map, head) = CELL_RABBIT;
+		game->rabbit = head;
+		--game->score;
+	} else { // tail cell is still in the ring, see SNAKE_RING_SIZE
+		MAP_ELEM(game->map, head) = CELL_EMPTY;
+		s->tail = _SNAKE_RING_PREV(s->tail);
+		MAP_ELEM(game->map, s->segments[s->tail]) = CELL_SNAKE;
 	}
+	return true;
 }
+#endif // SNAKE_GAME_REWIND_DEPTH
 
-#endif // SNAKE_GAME_H_
\ No newline at end of file
+#endif // SNAKE_GAME_H_
@@ -0,0 +1,38 @@
+/* Stack usage, measured by painting
+ *  Free RAM between the end of .bss and the top of RAM is filled with
+ * STACKMON_PAINT before main() (from .init3: stack pointer is set, .data and
+ * .bss are not initialized yet, they are below the painted area anyway).
+ * stackmon_unused() counts bytes above the end of .bss, which still have the
+ * paint, i.e. the least free RAM seen since reset, interrupts included.
+ * It takes a few cycles per byte, so call it from the main loop, not often.
+ *  Put into .init3 by the linker, so include it into one file only.
+ */
+
+#ifndef STACKMON_H_
+#define STACKMON_H_
+
+#include <avr/io.h>
+#include "decls.h"
+
+#define STACKMON_PAINT 0xC5
+
+extern byte_t _end; // end of .bss, from linker script
+extern byte_t __stack; // the last byte of RAM
+
+void _stackmon_paint(void) __attribute__((naked, used, section(".init3")));
+void _stackmon_paint(void)
+{
+	for (byte_t *p = &_end; p <= &__stack; ++p)
+		*p = STACKMON_PAINT;
+}
+
+/* bytes of stack, which were never used, a byte more or less */
+uint16_t stackmon_unused()
+{
+	const byte_t *p = &_end;
+	while (p <= &__stack && *p == STACKMON_PAINT)
+		++p;
+	return p - &_end;
+}
+
+#endif // STACKMON_H_
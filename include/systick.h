@@ -0,0 +1,86 @@
+/* Fast periodic system tick on timer0
+ *  Used for sampling inputs and as a time source for timestamps.
+ * Tick period is SYSTICK_PERIOD_MS (default 2 ms, which is the maximum for
+ * F_CPU = 1MHz with freq div 8 and 8-bit timer) */
+
+#ifndef SYSTICK_H_
+#define SYSTICK_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "decls.h"
+
+#ifndef SYSTICK_PERIOD_MS
+#define SYSTICK_PERIOD_MS 2
+#endif // SYSTICK_PERIOD_MS
+
+#define SYSTICK_FREQDIV 8
+#define SYSTICK_FREQDIV_MASK (1 << CS01)
+#define SYSTICK_OCR (F_CPU / SYSTICK_FREQDIV * SYSTICK_PERIOD_MS / 1000 - 1)
+
+#if SYSTICK_OCR > 255
+#error "SYSTICK_PERIOD_MS is too large for this F_CPU"
+#endif
+
+typedef void (*PFN_systick_callback)(void);
+
+static volatile uint16_t _systick_ticks;
+static volatile PFN_systick_callback _systick_callback = NULL;
+
+/*  Starts timer0 in CTC mode. callback is invoked from interrupt on every
+ * tick and may be NULL. Global interrupts must be enabled to count ticks */
+void systick_start(PFN_systick_callback callback)
+{
+	_systick_callback = callback;
+	OCR0 = SYSTICK_OCR;
+	TCNT0 = 0;
+	TCCR0 = (1 << WGM01) | SYSTICK_FREQDIV_MASK; // CTC mode
+	TIMSK |= 1 << OCIE0;
+}
+
+void systick_stop()
+{
+	TIMSK &= ~(1 << OCIE0);
+	TCCR0 = 0;
+}
+
+/* number of ticks since systick_start(), wraps around every ~131 seconds */
+uint16_t systick_now()
+{
+	byte_t sreg = SREG;
+	cli();
+	uint16_t res = _systick_ticks;
+	SREG = sreg;
+	return res;
+}
+
+/*  Time in units of SYSTICK_FREQDIV cpu cycles (8 us at 1MHz), wraps around
+ * every 65536 units. Good for measuring short intervals, also inside
+ * interrupts (pending tick is taken into account) */
+uint16_t systick_fine_now()
+{
+	byte_t sreg = SREG;
+	cli();
+	uint16_t ticks = _systick_ticks;
+	byte_t counter = TCNT0;
+	if ((TIFR & (1 << OCF0)) && counter < SYSTICK_OCR / 2) // tick interrupt is pending
+		++ticks;
+	SREG = sreg;
+	return ticks * (SYSTICK_OCR + 1) + counter;
+}
+
+#define SYSTICK_MS_TO_TICKS(ms) ((ms) / SYSTICK_PERIOD_MS)
+
+static inline void _systick_tick()
+{
+	++_systick_ticks;
+	if (_systick_callback)
+		_systick_callback();
+}
+
+/* with PROFILER_ENABLE the vector is in profiler.h, which calls _systick_tick() */
+#ifndef PROFILER_ENABLE
+ISR(TIMER0_COMP_vect) { _systick_tick(); }
+#endif // PROFILER_ENABLE
+
+#endif // SYSTICK_H_
@@ -0,0 +1,179 @@
+/* Compact binary protocol for telemetry and remote control
+ *  Frame: TELEMETRY_SYNC, type, length, payload (0..TELEMETRY_MAX_PAYLOAD
+ * bytes), crc8. crc8 (poly 0x07, init 0) covers type, length and payload.
+ * Multibyte values are little-endian. Messages from device have types
+ * below 0x80, commands from host - from 0x80.
+ *  This file is platform-independent, so host tools share it with firmware.
+ * Functions uart_tx_free() and uart_putc() must be declared before
+ * including it (include uart.h, or provide them on host).
+ *  Optional macros:
+ *  TELEMETRY_MAX_RX_PAYLOAD -- longest payload, which parser accepts, longer
+ *   frames are skipped. Default is TELEMETRY_MAX_PAYLOAD, device needs only
+ *   its commands
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include "decls.h"
+
+#define TELEMETRY_SYNC 0xA5
+#define TELEMETRY_MAX_PAYLOAD 16
+#define TELEMETRY_OVERHEAD 4 // sync, type, length, crc
+
+#ifndef TELEMETRY_MAX_RX_PAYLOAD
+#define TELEMETRY_MAX_RX_PAYLOAD TELEMETRY_MAX_PAYLOAD
+#endif // TELEMETRY_MAX_RX_PAYLOAD
+
+/* device -> host */
+typedef enum {
+	/* every game update: tick number (2), period since previous tick in
+	 * systick ticks (2), time spent in update in SYSTICK_FREQDIV cycles (2),
+	 * score (1), head x << 4 | y (1), direction (1) */
+	TM_MSG_TICK = 0x01,
+	/* event type (1), up to two arguments (see telemetry_event_t) */
+	TM_MSG_EVENT = 0x02,
+	/* answer to TM_CMD_GET_COUNTERS: duty permille (2), sleeps (2),
+	 * game ticks (2), dropped tx bytes (2), rx errors (2), dropped frames (2),
+	 * bytes of stack never used since reset (2, device only, see stackmon.h),
+	 * sleeps in adc noise reduction mode (2, device only, see power.h) */
+	TM_MSG_COUNTERS = 0x03,
+	/* sent after TM_MSG_COUNTERS: greyscale subframes per second (2),
+	 * cpu time spent on them, permille (2), the longest scroller step in
+	 * cycles (2, only if built with SCROLLER_MEASURE_CYCLES, see scroller.h) */
+	TM_MSG_RENDER = 0x04,
+	/* answer to TM_CMD_FLIGHTREC: number of the first record (1), then up to
+	 * 3 records: type (1), arg (1), systick ticks (2), TCNT0 (1). The last
+	 * frame has only the number of records (see flightrec.h) */
+	TM_MSG_FLIGHTREC = 0x05,
+	/* answer to TM_CMD_PROFILE: number of the first bucket (1), then up to 15
+	 * counters (1 each). The last frame is 0xFF, number of buckets (1), bucket
+	 * shift (1), address of the first bucket (2), samples outside (1),
+	 * see profiler.h */
+	TM_MSG_PROFILE = 0x06,
+
+/* host -> device */
+	TM_CMD_DIR = 0x81, // snake_dir_t (1), as if joystick was moved
+	TM_CMD_BUTTON = 0x82, // button_event_type_t (1), as if button was used: click is pressed, then released
+	TM_CMD_GET_COUNTERS = 0x83, // no payload
+	TM_CMD_SET_SETTINGS = 0x84, // intensity (1), speed curve (1), spawn mode (1), [level (1)]
+	TM_CMD_FLIGHTREC = 0x85, // telemetry_flightrec_op_t (1)
+	TM_CMD_PROFILE = 0x86 // telemetry_profile_op_t (1)
+} telemetry_msg_t;
+
+typedef enum {
+	TM_EV_GAME_START = 1, // rabbit x, rabbit y
+	TM_EV_RABBIT, // new rabbit x, y
+	TM_EV_GAME_OVER, // score (low, high)
+	TM_EV_PAUSE,
+	TM_EV_RESUME,
+	TM_EV_DIR, // new direction from joystick
+	TM_EV_REWIND // number of undone ticks, rabbit x << 4 | y
+} telemetry_event_t;
+
+typedef enum {
+	TM_FLIGHTREC_DUMP, TM_FLIGHTREC_FREEZE, TM_FLIGHTREC_UNFREEZE
+} telemetry_flightrec_op_t;
+
+typedef enum {
+	TM_PROFILE_DUMP, TM_PROFILE_RESET
+} telemetry_profile_op_t;
+
+typedef struct {
+	byte_t nreceived; // bytes of current frame, 0 - waiting for sync
+	byte_t type, len, crc;
+	byte_t payload[TELEMETRY_MAX_RX_PAYLOAD];
+} telemetry_parser_t;
+
+/* frames are sent from interrupts and from main loop, so they must not interleave */
+#ifdef __AVR__
+#define TELEMETRY_LOCK() byte_t _telemetry_sreg = SREG; cli()
+#define TELEMETRY_UNLOCK() SREG = _telemetry_sreg
+#else
+#define TELEMETRY_LOCK()
+#define TELEMETRY_UNLOCK()
+#endif // __AVR__
+
+static volatile uint16_t _telemetry_dropped; // frames, which didn't fit into tx buffer
+
+byte_t telemetry_crc8_update(byte_t crc, byte_t byte)
+{
+	crc ^= byte;
+	for (byte_t i = 0; i < 8; ++i)
+		crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+	return crc;
+}
+
+/*  Sends the whole frame or nothing, never waits.
+ * Returns false if frame was dropped. Crc is computed before the lock,
+ * so interrupts are disabled only while bytes are copied to tx buffer */
+bool_t telemetry_send(byte_t type, const byte_t *payload, byte_t len)
+{
+	byte_t crc = telemetry_crc8_update(telemetry_crc8_update(0, type), len);
+	for (byte_t i = 0; i < len; ++i)
+		crc = telemetry_crc8_update(crc, payload[i]);
+
+	TELEMETRY_LOCK();
+	bool_t res = (uart_tx_free() >= (unsigned int) len + TELEMETRY_OVERHEAD);
+	if (res) {
+		uart_putc(TELEMETRY_SYNC);
+		uart_putc(type);
+		uart_putc(len);
+		for (byte_t i = 0; i < len; ++i)
+			uart_putc(payload[i]);
+		uart_putc(crc);
+	} else
+		++_telemetry_dropped;
+	TELEMETRY_UNLOCK();
+	return res;
+}
+
+bool_t telemetry_send_event(byte_t event, byte_t arg0, byte_t arg1)
+{
+	byte_t payload[] = { event, arg0, arg1 };
+	return telemetry_send(TM_MSG_EVENT, payload, sizeof payload);
+}
+
+uint16_t telemetry_dropped() { return _telemetry_dropped; }
+
+void telemetry_parser_init(telemetry_parser_t *p)
+	{ p->nreceived = 0; }
+
+/*  Feeds one received byte to parser. Returns true, when a complete frame
+ * with valid crc is received, its type, length and payload may be read from
+ * parser until the next call. Broken frames are silently skipped */
+bool_t telemetry_parse_byte(telemetry_parser_t *p, byte_t byte)
+{
+	switch (p->nreceived) {
+	case 0:
+		if (byte == TELEMETRY_SYNC)
+			p->nreceived = 1;
+		return false;
+	case 1:
+		p->type = byte;
+		p->crc = telemetry_crc8_update(0, byte);
+		p->nreceived = 2;
+		return false;
+	case 2:
+		if (byte > TELEMETRY_MAX_RX_PAYLOAD) {
+			p->nreceived = 0;
+			return false;
+		}
+		p->len = byte;
+		p->crc = telemetry_crc8_update(p->crc, byte);
+		p->nreceived = 3;
+		return false;
+	}
+
+	byte_t pos = p->nreceived - 3;
+	if (pos < p->len) {
+		p->payload[pos] = byte;
+		p->crc = telemetry_crc8_update(p->crc, byte);
+		++p->nreceived;
+		return false;
+	}
+	p->nreceived = 0;
+	return byte == p->crc;
+}
+
+#endif // TELEMETRY_H_
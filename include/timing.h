@@ -3,9 +3,12 @@
 #ifndef TIMING_H_
 #define TIMING_H_
 
+#include "power.h"
+
 typedef void (*PFN_timer_callback)(void);
 
 static volatile PFN_timer_callback _timer1a_callback;
+static volatile bool_t _timer1a_wait_done;
 
 /* Timer1 is used with frequency divisor = 1024
  * It allows to count from 1 to ~65 seconds if F_CPU = 1000000 (1MHz) */
@@ -49,12 +52,27 @@ void timer1a_stop()
 	TIMSK &= ~(1 << OCIE1A); // disable timer1a interrupts
 }
 
+static void _timer1a_wait_callback() { _timer1a_wait_done = true; }
+
+/*  Sleeps until timeout expires. Previously started timer1a callbacks
+ * are stopped.
+ *  If global interrupts are disabled, nothing can wake us up,
+ * so the timer is polled instead */
 void timer1a_wait_ms(uint16_t timeout_ms)
 {
 	timer1a_stop(); //disable timer1a interrupts
 	_timer1a_start_counting(timeout_ms);
-	while (TCNT1 < OCR1A)
-		;
+
+	if (!(SREG & (1 << SREG_I))) {
+		while (TCNT1 < OCR1A)
+			;
+		return;
+	}
+	_timer1a_wait_done = false;
+	_timer1a_callback = _timer1a_wait_callback;
+	TIMSK |= 1 << OCIE1A;
+	power_idle_until(&_timer1a_wait_done);
+	timer1a_stop();
 }
 
 ISR(TIMER1_COMPA_vect) { _timer1a_callback(); }
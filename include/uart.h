@@ -0,0 +1,124 @@
+/* Interrupt-driven USART with ring buffers
+ *  Connection: avr TXD (PD1) --> host RX, avr RXD (PD0) <-- host TX,
+ * 8 data bits, no parity, 1 stop bit.
+ *  Optional macros:
+ *  UART_BAUD -- default is 9600 (0.2% error at F_CPU = 1MHz with U2X)
+ *  UART_TX_BUFFER_SIZE -- must be a power of 2, default is 32
+ *  UART_RX_BUFFER_SIZE -- must be a power of 2, default is 16
+ *  Bytes, which don't fit into buffers, are dropped and counted,
+ * writers never wait.
+ */
+
+#ifndef UART_H_
+#define UART_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "decls.h"
+
+#ifndef UART_BAUD
+#define UART_BAUD 9600
+#endif // UART_BAUD
+
+#ifndef UART_TX_BUFFER_SIZE
+#define UART_TX_BUFFER_SIZE 32
+#endif // UART_TX_BUFFER_SIZE
+
+#ifndef UART_RX_BUFFER_SIZE
+#define UART_RX_BUFFER_SIZE 16
+#endif // UART_RX_BUFFER_SIZE
+
+/* double speed mode, baud = F_CPU / (8 * (UBRR + 1)) */
+#define UART_UBRR ((F_CPU + UART_BAUD * 4UL) / (UART_BAUD * 8UL) - 1)
+
+static byte_t _uart_tx_buffer[UART_TX_BUFFER_SIZE];
+static volatile byte_t _uart_tx_head, _uart_tx_tail;
+static byte_t _uart_rx_buffer[UART_RX_BUFFER_SIZE];
+static volatile byte_t _uart_rx_head, _uart_rx_tail;
+
+static volatile uint16_t _uart_tx_dropped; // bytes, which didn't fit in tx buffer
+static volatile uint16_t _uart_rx_errors; // framing errors, overruns and rx buffer overflows
+
+void uart_init()
+{
+	UBRRH = (byte_t) (UART_UBRR >> 8);
+	UBRRL = (byte_t) UART_UBRR;
+	UCSRA = 1 << U2X;
+	UCSRC = (1 << URSEL) | (1 << UCSZ1) | (1 << UCSZ0); // 8n1
+	UCSRB = (1 << RXEN) | (1 << TXEN) | (1 << RXCIE);
+}
+
+/* number of bytes, which may be written without drops */
+byte_t uart_tx_free()
+	{ return (_uart_tx_tail - _uart_tx_head - 1) & (UART_TX_BUFFER_SIZE - 1); }
+
+/* Nonblock, returns false if tx buffer is full */
+bool_t uart_putc(byte_t byte)
+{
+	byte_t sreg = SREG;
+	cli();
+
+	byte_t next = (_uart_tx_head + 1) & (UART_TX_BUFFER_SIZE - 1);
+	bool_t res = (next != _uart_tx_tail);
+	if (res) {
+		_uart_tx_buffer[_uart_tx_head] = byte;
+		_uart_tx_head = next;
+		UCSRB |= 1 << UDRIE;
+	} else
+		++_uart_tx_dropped;
+
+	SREG = sreg;
+	return res;
+}
+
+/*  Receiver may be switched off, e.g. to let the cpu sleep in adc noise
+ * reduction mode, which stops its clock anyway. Received bytes are kept */
+void uart_rx_enable(bool_t enable)
+{
+	if (enable)
+		UCSRB |= 1 << RXEN | 1 << RXCIE;
+	else
+		UCSRB &= ~(1 << RXEN | 1 << RXCIE);
+}
+
+bool_t uart_rx_available()
+	{ return _uart_rx_head != _uart_rx_tail; }
+
+/* Nonblock, returns -1 if nothing was received */
+int16_t uart_getc()
+{
+	if (_uart_rx_head == _uart_rx_tail)
+		return -1;
+	byte_t byte = _uart_rx_buffer[_uart_rx_tail];
+	_uart_rx_tail = (_uart_rx_tail + 1) & (UART_RX_BUFFER_SIZE - 1);
+	return byte;
+}
+
+uint16_t uart_tx_dropped() { return _uart_tx_dropped; }
+uint16_t uart_rx_errors() { return _uart_rx_errors; }
+
+ISR(USART_RXC_vect)
+{
+	bool_t is_error = !!(UCSRA & (1 << FE | 1 << DOR));
+	byte_t byte = UDR; // must be read after UCSRA
+	byte_t next = (_uart_rx_head + 1) & (UART_RX_BUFFER_SIZE - 1);
+
+	if (is_error || next == _uart_rx_tail) {
+		++_uart_rx_errors;
+		return;
+	}
+	_uart_rx_buffer[_uart_rx_head] = byte;
+	_uart_rx_head = next;
+}
+
+ISR(USART_UDRE_vect)
+{
+	if (_uart_tx_head == _uart_tx_tail) {
+		UCSRB &= ~(1 << UDRIE); // nothing to send
+		return;
+	}
+	UDR = _uart_tx_buffer[_uart_tx_tail];
+	_uart_tx_tail = (_uart_tx_tail + 1) & (UART_TX_BUFFER_SIZE - 1);
+}
+
+#endif // UART_H_
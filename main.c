@@ -1,82 +1,267 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 
+/*  RAM budget of ATmega8535 is 512 bytes: .data + .bss are about 430 bytes
+ * with the configuration below (game 183, layers 38, uart buffers 40,
+ * flightrec 20; `make size` prints the exact numbers), the rest is stack.
+ * The deepest chain is the game tick (timer1 interrupt with
+ * game_update_callback(), draw_game(), compositor) on top of the game loop
+ * in run_game(), so images are kept off this path: layers are composed into
+ * greyscale planes in place, score is shown from a function of its own.
+ * Stack is painted (stackmon.h), the least free stack since reset is the
+ * last of TM_MSG_COUNTERS, check it after changes */
+
+/*  Sampling profiler (profiler.h) takes over the systick vector, costs 37
+ * bytes of RAM and lets interrupts nest, so the profiling build
+ * (make CFLAGS=-DPROFILER_ENABLE) goes without the flight recorder and
+ * with shorter rewind: 10 bytes less static RAM than the usual one */
+// #define PROFILER_ENABLE
+
+/* flight recorder (flightrec.h) hooks are compiled into all modules */
+#ifndef PROFILER_ENABLE
+#define FLIGHTREC_ENABLE
+#define FLIGHTREC_SIZE 4 // 20 bytes of RAM
+#endif // PROFILER_ENABLE
+
 /* images, etc */
 #define DRAWING_USING_COMMON_IMAGES
-#define DRAWING_USING_NUMBERS
+#define DRAWING_USING_LETTERS
+#define DRAWING_USING_FRAMEBUFFER // flushed on systick
+#define DISPLAY_ORIENTATION ORIENT_NORMAL // see orient.h, joystick follows
 #include "drawing.h"
 
 /* snake game configuration */
 #define MAX_SNAKE_LENGTH 64
 #define SNAKE_GAME_WIDTH 8
 #define SNAKE_GAME_HEIGHT 8
+#ifndef PROFILER_ENABLE
+#define SNAKE_GAME_REWIND_DEPTH 16 // 1.6 seconds at the highest speed, 34 bytes of RAM
+#else
+#define SNAKE_GAME_REWIND_DEPTH 4 // 10 bytes of RAM
+#endif // PROFILER_ENABLE
 #include "snake_game.h"
+#include "levels.h"
 
 /* legs for connecting joystick */
 #define JOYSTICK_VX_PIN 0
 #define JOYSTICK_VY_PIN 1
 
-/* mappings from joystick directions to directions in snake game */
+/*  Joystick directions have values of directions in snake game, as they are
+ * seen on the matrix with JOYSTICK_ORIENTATION, see orient_input_dir() */
 typedef enum {
 	JOYSTICK_UNKNOWN	= DIR_UNKNOWN,
-	JOYSTICK_LEFT		= DIR_UP,
-	JOYSTICK_RIGHT		= DIR_DOWN,
-	JOYSTICK_UP		 	= DIR_LEFT,
-	JOYSTICK_DOWN		= DIR_RIGHT
+	JOYSTICK_LEFT		= DIR_LEFT,
+	JOYSTICK_RIGHT		= DIR_RIGHT,
+	JOYSTICK_UP		 	= DIR_UP,
+	JOYSTICK_DOWN		= DIR_DOWN
 } joystick_dir_t;
+#define JOYSTICK_ORIENTATION ORIENT_TRANSPOSE // mounted with swapped axes
 
 #include "async_joystick.h"
 #include "timing.h"
 #include "effects.h"
 
+/* effects, which are played from flash (anim.h, assets/animations.txt),
+ * comment out to compute them at runtime */
+#define ANIM_USING_COUNTDOWN
+#define ANIM_USING_GOOD_MARK_TEXT
+#define ANIM_USING_GOOD_MARK_SPLIT
+#include "anim.h"
+#include "power.h"
+#define PERSIST_NLEVELS NLEVELS
+#include "persist.h"
+#define UART_RX_BUFFER_SIZE 8 // one frame of the longest command
+#include "uart.h"
+#define TELEMETRY_MAX_RX_PAYLOAD 4 // TM_CMD_SET_SETTINGS is the longest command
+#include "telemetry.h"
+#include "greyscale.h"
+#define COMPOSITOR_NPLANES GREYSCALE_NPLANES
+#include "compositor.h"
+#ifdef FLIGHTREC_ENABLE
+#include "flightrec.h"
+#endif
+#include "stackmon.h"
+#ifdef PROFILER_ENABLE
+#include "profiler.h"
+#endif
+
+/* attract mode is left for standby after this number of seconds without input */
+#define ATTRACT_MODE_TIMEOUT_S 30
+/*  remote commands are accepted during this number of seconds of attract mode,
+ * then uart receiver is switched off to let the cpu sleep in adc noise reduction */
+#define ATTRACT_MODE_REMOTE_S 5
+
+/* after death rewind is offered for REWIND_OFFER_MS, game goes back by REWIND_MS */
+#define REWIND_OFFER_MS 2000
+#define REWIND_MS 2000
+
 /* port for connecting button on joystick */
 #define BUTTON_PORT PORTA
 #define BUTTON_PORTDD DDRA
 #define BUTTON_PORTIN PINA
-#include "button.h"
 #define JOYSTICK_BUTTON_PIN 2
+#define BUTTON_NPINS (JOYSTICK_BUTTON_PIN + 1)
+#include "button.h"
 
 snake_game_t game;
 volatile snake_dir_t snake_dir = DIR_UNKNOWN;
-volatile bool_t show_message_for_good_mark = false;
+bool_t show_message_for_good_mark = false;
+bool_t game_is_paused = false;
+bool_t pause_on_release = false; // button was pressed in the game, not long yet
+
+/* for telemetry */
+telemetry_parser_t remote;
+uint16_t game_ticks = 0;
+uint16_t last_tick_time = 0; // systick_now() at the start of previous update
+
+/* defaults, used when EEPROM is blank */
+persist_settings_t settings = {
+	.high_score = 0,
+	.intensity = 15,
+	.speed_curve = SPEED_CURVE_NORMAL,
+	.spawn_mode = SPAWN_SPACIOUS,
+	.level = 0
+};
+
+/*  Game is composed from layers (see compositor.h), so changed rows only
+ * are recomputed. Snake body is dim, walls and head are on a brighter layer,
+ * which adds up with body in the head, rabbit pulses from dim to bright,
+ * overlay is inverted over everything during pause */
+enum { LAYER_BODY, LAYER_BRIGHT, LAYER_RABBIT, LAYER_OVERLAY };
+#define LEVEL_BODY 1
+#define LEVEL_BRIGHT 2 // walls, head has LEVEL_BODY | LEVEL_BRIGHT
+static const byte_t rabbit_levels[] PROGMEM = { 1, 2, 3, 2 };
+compositor_t layers;
+
+void init_layers()
+{
+	compositor_init(&layers);
+	compositor_set_mode(&layers, LAYER_BODY, COMPOSITOR_OR, LEVEL_BODY);
+	compositor_set_mode(&layers, LAYER_BRIGHT, COMPOSITOR_OR, LEVEL_BRIGHT);
+	image_t pause = {};
+	image_draw_packed(pause, prog_img_pause);
+	orient_image(pause, DISPLAY_ORIENTATION);
+	compositor_set_image(&layers, LAYER_OVERLAY, pause);
+	compositor_set_mode(&layers, LAYER_OVERLAY, COMPOSITOR_XOR, GREYSCALE_MAX_LEVEL);
+	compositor_enable(&layers, LAYER_BODY, true);
+	compositor_enable(&layers, LAYER_BRIGHT, true);
+	compositor_enable(&layers, LAYER_RABBIT, true);
+}
 
-void draw_game_map(snake_game_map_t map)
+/*  Composes changed rows right into planes of greyscale, which must be
+ * started. Layers are also changed in game_update_callback(), so interrupts
+ * are disabled */
+void flush_layers()
+{
+	byte_t sreg = SREG;
+	cli();
+	if (compositor_compose(&layers, greyscale_front()))
+		FLIGHTREC_EVENT(FR_FLUSH, 0); // rows are sent on the next subframes
+	SREG = sreg;
+}
+
+#if SNAKE_GAME_WIDTH != MAX_IMAGE_WIDTH || SNAKE_GAME_HEIGHT != MAX_IMAGE_HEIGHT
+#error "draw_game() shows the board on the whole matrix"
+#endif
+
+/*  Called from game_update_callback(). Layers go to greyscale as they are,
+ * so rows are built in matrix coordinates: DISPLAY_ORIENTATION is folded
+ * into the cell index at compile time */
+void draw_game(const snake_game_t *g)
+{
+	cell_idx_t head = g->snake.segments[g->snake.head];
+	byte_t rabbit_x = ORIENT_DST_X(SNAKE_CELL_X(g->rabbit), SNAKE_CELL_Y(g->rabbit), DISPLAY_ORIENTATION);
+	byte_t rabbit_y = ORIENT_DST_Y(SNAKE_CELL_X(g->rabbit), SNAKE_CELL_Y(g->rabbit), DISPLAY_ORIENTATION);
+
+	/* x = 0 is the left column, i.e. the highest bit of row */
+	for (byte_t y = 0; y < MAX_IMAGE_HEIGHT; ++y) {
+		byte_t body = 0, bright = 0;
+		for (byte_t x = 0; x < MAX_IMAGE_WIDTH; ++x) {
+			cell_idx_t cell = SNAKE_CELL(ORIENT_SRC_X(x, y, DISPLAY_ORIENTATION),
+				ORIENT_SRC_Y(x, y, DISPLAY_ORIENTATION));
+			body = body << 1 | (MAP_ELEM(g->map, cell) == CELL_SNAKE);
+			bright = bright << 1 | (WALL_ELEM(g->walls, cell) != 0 || cell == head);
+		}
+		compositor_set_row(&layers, LAYER_BODY, y, body);
+		compositor_set_row(&layers, LAYER_BRIGHT, y, bright);
+		compositor_set_row(&layers, LAYER_RABBIT, y, y == rabbit_y ? 0x80 >> rabbit_x : 0);
+	}
+	compositor_set_mode(&layers, LAYER_RABBIT, COMPOSITOR_OR,
+		pgm_read_byte(&rabbit_levels[game_ticks % ARR_SZ(rabbit_levels)]));
+	flush_layers();
+}
+
+/*  After greyscale_stop() the matrix keeps one bit-plane, so the board is
+ * shown flat: everything, which glows at any level. Built from the game,
+ * not from the planes, they are oriented for the matrix already */
+void show_game_flat(const snake_game_t *g)
 {
 	image_t image = {};
-	for (unsigned int y = 0; y < SNAKE_GAME_HEIGHT; ++y)
-		for (unsigned int x = 0; x < SNAKE_GAME_WIDTH; ++x)
-			if (map[y][x])
-				BIT_SET(image[y], SNAKE_GAME_WIDTH - x - 1);
+	for (byte_t y = 0; y < SNAKE_GAME_HEIGHT; ++y)
+		for (byte_t x = 0; x < SNAKE_GAME_WIDTH; ++x) {
+			cell_idx_t cell = SNAKE_CELL(x, y);
+			if (MAP_ELEM(g->map, cell) != CELL_EMPTY || WALL_ELEM(g->walls, cell))
+				image_set_px(image, y, SNAKE_GAME_WIDTH - x - 1);
+		}
 	image_show_max7219(image);
 }
 
 /* return val is in milliseconds */
 uint16_t score_to_speed(int score)
-{
-	if (score < 3)
-		return 500;
-	else if (score < 5)
-		return 300;
-	else if (score < 10)
-		return 250;
-	else if (score < 15)
-		return 200;
-	else if (score < 25)
-		return 200 - (score - 15) * 10;
-	else
-		return 100;
-}
+	{ return snake_score_to_speed(score, settings.speed_curve); }
 
 /* called on timer1 interrupts during active game phase */
 void game_update_callback()
 {
-	if (button_is_pressed(JOYSTICK_BUTTON_PIN)) {
-		show_message_for_good_mark = true;
-		return;
-	}
+	uint16_t start = systick_fine_now();
+	uint16_t now = systick_now();
+	unsigned int prev_score = game.score;
+	FLIGHTREC_EVENT(FR_TICK_START, prev_score);
+
 	snake_game_update(&game, snake_dir);
-	draw_game_map(game.map);
+	draw_game(&game);
 	timer1a_change_timeout_ms(score_to_speed(game.score));
+
+	if (game.score != prev_score)
+		telemetry_send_event(TM_EV_RABBIT, SNAKE_CELL_X(game.rabbit), SNAKE_CELL_Y(game.rabbit));
+
+	uint16_t duration = systick_fine_now() - start;
+	uint16_t period = now - last_tick_time;
+	cell_idx_t head = game.snake.segments[game.snake.head];
+	byte_t payload[] = {
+		game_ticks, game_ticks >> 8,
+		period, period >> 8,
+		duration, duration >> 8,
+		game.score,
+		SNAKE_CELL_X(head) << 4 | SNAKE_CELL_Y(head),
+		game.snake.dir
+	};
+	telemetry_send(TM_MSG_TICK, payload, sizeof payload);
+	last_tick_time = now;
+	++game_ticks;
+
+	FLIGHTREC_EVENT(FR_TICK_END, game.score);
+	if (game.is_finished) { // keep events, which led to death
+		FLIGHTREC_EVENT(FR_GAME_OVER, game.score);
+#ifdef FLIGHTREC_ENABLE
+		flightrec_freeze();
+#endif
+	}
+}
+
+/*  Buttons are sampled and frames, shown with image_show_max7219(),
+ * are sent to display on systick (see framebuffer.h) */
+void systick_callback()
+{
+	button_service_tick();
+	framebuffer_flush();
+}
+
+/* direction in the picture, from joystick or remote */
+void set_snake_dir(snake_dir_t dir)
+{
+	snake_dir = dir;
+	telemetry_send_event(TM_EV_DIR, dir, 0);
 }
 
 /* called by async_joystick notifications */
@@ -87,108 +272,274 @@ void snake_dir_update_callback(joystick_dir_t dir)
 	 * It feels much more convinient during playing. Implementation
 	 * of this behaviour why I have to use asynchronous access to joystick */
 	if (dir != DIR_UNKNOWN)
-		snake_dir = (snake_dir_t) dir;
+		set_snake_dir((snake_dir_t) orient_input_dir(dir, JOYSTICK_ORIENTATION));
 }
 
-void start_countdown(int from)
+void send_counters()
 {
-	static cimage_t image_zero PROGMEM = {
-		0b00000000,
-		0b00000000,
-		0b01110010,
-		0b01010010,
-		0b01010010,
-		0b01010000,
-		0b01110010,
-		0b00000000
+	power_stats_t stats;
+	power_get_stats(&stats);
+
+	uint16_t counters[] = {
+		power_duty_permille(), stats.nsleeps, game_ticks,
+		uart_tx_dropped(), uart_rx_errors(), telemetry_dropped(), stackmon_unused(),
+		stats.nsleeps_adc
+	};
+	byte_t payload[2 * ARR_SZ(counters)];
+	for (unsigned int i = 0; i < ARR_SZ(counters); ++i) {
+		payload[2 * i] = counters[i];
+		payload[2 * i + 1] = counters[i] >> 8;
+	}
+	telemetry_send(TM_MSG_COUNTERS, payload, sizeof payload);
+
+	uint16_t render[] = {
+		greyscale_subframes_per_s(), greyscale_cpu_permille(),
+#ifdef SCROLLER_MEASURE_CYCLES
+		scroller_max_cycles
+#endif
 	};
+	for (unsigned int i = 0; i < ARR_SZ(render); ++i) {
+		payload[2 * i] = render[i];
+		payload[2 * i + 1] = render[i] >> 8;
+	}
+	telemetry_send(TM_MSG_RENDER, payload, 2 * ARR_SZ(render));
+}
 
-	for (int i = from; i > 0; --i) {
+/*  Handles commands from host (see telemetry.h). Directions and button
+ * events go the same way as from real joystick and button.
+ * Returns true if there was user input */
+bool_t process_remote_commands()
+{
+	bool_t got_input = false;
+	int16_t byte;
+
+	while ((byte = uart_getc()) >= 0) {
+		if (!telemetry_parse_byte(&remote, byte))
+			continue;
+
+		switch (remote.type) {
+		case TM_CMD_DIR: {
+			snake_dir_t dir = (int8_t) remote.payload[0];
+			if (remote.len == 1 && (dir == DIR_LEFT || dir == DIR_RIGHT || dir == DIR_UP || dir == DIR_DOWN)) {
+				set_snake_dir(dir);
+				got_input = true;
+			}
+			break;
+		}
+		case TM_CMD_BUTTON:
+			if (remote.len == 1 && remote.payload[0] <= BUTTON_LONG_PRESSED) {
+				button_inject_event(remote.payload[0], JOYSTICK_BUTTON_PIN);
+				got_input = true;
+			}
+			break;
+		case TM_CMD_GET_COUNTERS:
+			send_counters();
+			break;
+		case TM_CMD_SET_SETTINGS:
+			if (remote.len == 3 || remote.len == 4) {
+				settings.intensity = remote.payload[0] & 0x0F;
+				settings.speed_curve = remote.payload[1];
+				settings.spawn_mode = remote.payload[2];
+				if (remote.len == 4)
+					settings.level = remote.payload[3]; // from the next game
+				cli(); // greyscale interrupt also writes to max7219
+				max7219_set_intencity(settings.intensity);
+				sei();
+				persist_save(&settings);
+			}
+			break;
+#ifdef FLIGHTREC_ENABLE
+		case TM_CMD_FLIGHTREC:
+			if (remote.len != 1)
+				break;
+			if (remote.payload[0] == TM_FLIGHTREC_DUMP)
+				flightrec_dump();
+			else if (remote.payload[0] == TM_FLIGHTREC_FREEZE) {
+				FLIGHTREC_EVENT(FR_TRIGGER, 0);
+				flightrec_freeze();
+			} else if (remote.payload[0] == TM_FLIGHTREC_UNFREEZE)
+				flightrec_unfreeze();
+			break;
+#endif
+#ifdef PROFILER_ENABLE
+		case TM_CMD_PROFILE:
+			if (remote.len != 1)
+				break;
+			if (remote.payload[0] == TM_PROFILE_DUMP)
+				profiler_dump();
+			else if (remote.payload[0] == TM_PROFILE_RESET)
+				profiler_reset();
+			break;
+#endif // PROFILER_ENABLE
+		}
+	}
+	return got_input;
+}
+
+#define COUNTDOWN_FROM 3 // anim_countdown is baked from 3 as well
+
+void start_countdown()
+{
+#ifdef ANIM_USING_COUNTDOWN
+	anim_play(anim_countdown);
+#else
+	for (int i = COUNTDOWN_FROM; i > 0; --i) {
 		image_t number = {};
 		image_emplace_number(number, i);
 		image_show_max7219(number);
 		timer1a_wait_ms(1000);
 	}
-	image_show_max7219(image_progread(image_zero));
+	image_show_packed_max7219(prog_img_countdown_go);
 	timer1a_wait_ms(1000);
+#endif
 }
 
 void ask_for_good_mark()
 {
-	static ctext_t text PROGMEM = {
-		{
-			0b11100100,
-			0b10101010,
-			0b10101010,
-			0b10101010,
-			0b10100100
-		}, {
-			0b01101110,
-			0b10000100,
-			0b10000100,
-			0b10000100,
-			0b01100100
-		}, {
-			0b01001100,
-			0b10101010,
-			0b11101100,
-			0b10101010,
-			0b10101100
-		}, {
-			0b10001110,
-			0b10000100,
-			0b11100100,
-			0b10100100,
-			0b11100100
-		}, {
-			0b11100000,
-			0b10000000,
-			0b11100000,
-			0b10000000,
-			0b11100000
-		}, {
-			0b00000000,
-			0b00000000,
-			0b00000000,
-			0b00000000,
-			0b00000000
-		}
-	};
+#ifdef ANIM_USING_GOOD_MARK_TEXT
+	anim_play(anim_good_mark_text);
+#else
+	/* "ПОСТАВЬТЕ" (put [a mark]) */
+	static const char text[] PROGMEM = FONT_CHAR_PE "OCTAB" FONT_CHAR_SOFT_SIGN "TE";
 
-	draw_effect_moving_text(text, ARR_SZ(text), 250);
+	draw_effect_moving_text(text, 250);
+#endif
 
 	image_t image = {};
 	image_emplace_number(image, 10);
 	image_show_max7219(image);
 
-	draw_effect_blink(250, 5);
+	draw_effect_blink(250, 5); // shutdown only, nothing to bake
 
+#ifdef ANIM_USING_GOOD_MARK_SPLIT
+	anim_play(anim_good_mark_split);
+#else
 	draw_effect_shift_to_sides(image, 700);
+#endif
 	timer1a_wait_ms(300);
 
-	image_show_max7219(image_progread(prog_img_smile));
+	image_show_packed_max7219(prog_img_smile);
 	timer1a_wait_ms(3000);
 }
 
-void wait(long ncycles)
+/* short press pauses or resumes the game, long press asks for good mark */
+void handle_button_event(const button_event_t *event)
+{
+	if (event->pin != JOYSTICK_BUTTON_PIN)
+		return;
+
+	/*  Long press is reported while the button is still down, so pause
+	 * is toggled on release of a short press, which started in the game */
+	if (event->type == BUTTON_PRESSED)
+		pause_on_release = true;
+	else if (event->type == BUTTON_LONG_PRESSED) {
+		pause_on_release = false;
+		show_message_for_good_mark = true;
+	} else if (event->type == BUTTON_RELEASED && pause_on_release) {
+		pause_on_release = false;
+		game_is_paused = !game_is_paused;
+		if (game_is_paused) {
+			timer1a_stop();
+			telemetry_send_event(TM_EV_PAUSE, 0, 0);
+		} else {
+			timer1a_start_ms(score_to_speed(game.score), game_update_callback);
+			telemetry_send_event(TM_EV_RESUME, 0, 0);
+		}
+		compositor_enable(&layers, LAYER_OVERLAY, game_is_paused);
+		flush_layers();
+	}
+}
+
+/*  After death player may press the button to return REWIND_MS back in
+ * the game. Returns true if game was rewound and should go on */
+bool_t offer_rewind()
 {
-	while (ncycles-- > 0)
-		asm volatile ("nop");
+	bool_t accepted = false;
+	button_event_t event;
+
+	button_flush_events();
+	for (unsigned int i = 0; i < REWIND_OFFER_MS / 100 && !accepted; ++i) {
+		timer1a_wait_ms(100);
+		process_remote_commands();
+		while (button_get_event(&event))
+			if (event.pin == JOYSTICK_BUTTON_PIN && event.type == BUTTON_PRESSED)
+				accepted = true;
+	}
+	if (!accepted)
+		return false;
+
+	byte_t nticks = 0;
+	for (uint16_t ms = 0; ms < REWIND_MS && snake_game_rewind(&game); ms += score_to_speed(game.score))
+		++nticks;
+	telemetry_send_event(TM_EV_REWIND, nticks,
+		SNAKE_CELL_X(game.rabbit) << 4 | SNAKE_CELL_Y(game.rabbit));
+
+	snake_dir = DIR_UNKNOWN;
+	draw_game(&game);
+	timer1a_wait_ms(1000); // let player see, where the snake is
+	button_flush_events();
+	pause_on_release = false;
+	return true;
+}
+
+/* not a part of run_game(), so the scroller isn't on stack during the game */
+void show_score(unsigned int score)
+{
+	image_t image = {};
+	if (score < 100) {
+		image_emplace_number(image, score);
+		image_show_max7219(image);
+		timer1a_wait_ms(3000);
+	} else {
+		scroller_t scroller;
+		scroller_start_number(&scroller, score, 2);
+		draw_effect_scroll(&scroller, image, 100);
+	}
 }
 
 /* may be called multiple times */
 void run_game()
 {
 	snake_dir = DIR_UNKNOWN;
+	game.spawn_mode = settings.spawn_mode;
+	game.seed ^= TCNT1; // time of the first joystick touch is random enough
+	level_load(&game, settings.level);
+#ifdef FLIGHTREC_ENABLE
+	flightrec_unfreeze(); // trace of the previous game is lost
+#endif
 	snake_game_init(&game); // configure game
-	start_countdown(3);
-	timer1a_start_ms(score_to_speed(game.score), game_update_callback);
+	telemetry_send_event(TM_EV_GAME_START, SNAKE_CELL_X(game.rabbit), SNAKE_CELL_Y(game.rabbit));
+	start_countdown();
+	game_is_paused = pause_on_release = false;
+	button_flush_events();
+	init_layers();
+	greyscale_start();
 
 	volatile snake_game_t *pgame = &game;
-	while (!pgame->is_finished && !show_message_for_good_mark)
-		;
+	do {
+		timer1a_start_ms(score_to_speed(game.score), game_update_callback);
+		for (;;) {
+			button_event_t event;
+
+			cli();
+			if (pgame->is_finished || show_message_for_good_mark)
+				break;
+			if (!button_has_events() && !uart_rx_available())
+				power_idle(); // everything happens in interrupts
+			sei();
+
+			process_remote_commands();
+			while (button_get_event(&event))
+				handle_button_event(&event);
+		}
+		sei();
+		timer1a_stop();
+	} while (game.is_finished && offer_rewind());
 
-	timer1a_stop();
+	greyscale_stop();
+	show_game_flat(&game);
+	if (game.is_finished)
+		telemetry_send_event(TM_EV_GAME_OVER, game.score, game.score >> 8);
 
 	if (show_message_for_good_mark) {
 		cli();
@@ -200,20 +551,80 @@ void run_game()
 
 	draw_effect_blink(250, 5);
 
-	image_t score = {};
-	image_emplace_number(score, game.score);
-	image_show_max7219(score);
+	if (game.score > settings.high_score) {
+		settings.high_score = game.score;
+		persist_save(&settings); // written in background
+		image_show_packed_max7219(prog_img_smile);
+		timer1a_wait_ms(1000);
+	}
 
-	timer1a_wait_ms(3000);
+	show_score(game.score);
+}
+
+/*  Scrolls high score until user touches joystick or button.
+ * If nobody does during ATTRACT_MODE_TIMEOUT_S, unit goes to standby */
+void attract_mode()
+{
+	static const char text[] PROGMEM = "HI ";
+	image_t image = {};
+	scroller_t scroller;
+	bool_t is_number = false;
+
+	/*  Nothing here needs the systick: the button is read raw and frames
+	 * are flushed right away, so the cpu isn't woken every 2 ms. When the
+	 * receiver is off too, frames are timed by adc conversions and the cpu
+	 * sleeps in adc noise reduction mode between them */
+	systick_stop();
+	scroller_start_P(&scroller, text, 2);
+	for (unsigned int i = 0; i < ATTRACT_MODE_TIMEOUT_S * 10; ++i) {
+		if (async_joystick_getdir() != JOYSTICK_UNKNOWN
+			|| button_is_pressed(JOYSTICK_BUTTON_PIN)
+			|| process_remote_commands()) {
+			uart_rx_enable(true);
+			systick_start(systick_callback);
+			return;
+		}
+		if (i == ATTRACT_MODE_REMOTE_S * 10)
+			uart_rx_enable(false);
+
+		if (!scroller_step(&scroller, image)) { // "HI " and number one after another
+			is_number = !is_number;
+			if (is_number)
+				scroller_start_number(&scroller, settings.high_score, 2);
+			else
+				scroller_start_P(&scroller, text, 2);
+		}
+		image_show_max7219(image);
+		cli();
+		framebuffer_flush();
+		sei();
+		if (i < ATTRACT_MODE_REMOTE_S * 10)
+			timer1a_wait_ms(100);
+		else
+			power_idle_conversions(100000UL / ASYNC_JOYSTICK_CONVERSION_US);
+	}
+	uart_rx_enable(true);
+	power_standby();
 }
 
 int main()
 {
+	/* buttons configuration */
+	button_init_ports(JOYSTICK_BUTTON_PIN);
+
 	/* led matrix configuration */
 	max7219_init_ports();
+
+	/* in standby watchdog wakes us up periodically, only button press
+	 * should return unit to life. Display is still shut down here */
+	if (power_is_standby_wakeup() && !button_is_pressed(JOYSTICK_BUTTON_PIN))
+		power_standby();
+
+	persist_load(&settings);
+
 	max7219_clear_digits();
 	max7219_set_ndigits(8);
-	max7219_set_intencity(15);
+	max7219_set_intencity(settings.intensity);
 	max7219_wakeup();
 
 	/* timers configuration */
@@ -224,12 +635,18 @@ int main()
 	async_joystick_start();
 	async_joystick_start_notify(snake_dir_update_callback); // enable notifications about direction changes
 
-	/* buttons configuration */
-	button_init_ports(JOYSTICK_BUTTON_PIN);
+	/* buttons are sampled and frames are flushed on systick */
+	systick_start(systick_callback);
+
+	/* telemetry and remote control */
+	uart_init();
+	telemetry_parser_init(&remote);
 
 	sei();
 
-	while (1)
+	while (1) {
 		run_game();
+		attract_mode();
+	}
 	return 0;
 }
\ No newline at end of file
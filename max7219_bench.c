@@ -0,0 +1,111 @@
+/*  Benchmark of max7219 backends: cycles per packet, cycles per full 8x8
+ * frame (8 packets, as image_show_max7219() does) and corresponding rates.
+ * Results are printed to USART (9600 8n1) once per second, e.g.
+ *  max7219 spi: P cycles/packet, F_CPU/P packets/s, F cycles/frame, F_CPU/F frames/s
+ *  Build and flash:
+ *  make TARGET=max7219_bench flash                       -- hardware SPI
+ *  make TARGET=max7219_bench CFLAGS=-DBENCH_BITBANG flash  -- bit-bang
+ * Bit-bang uses the same pins as SPI, so display stays on the same wires.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+#include <stdlib.h>
+
+#ifdef BENCH_BITBANG
+#define MAX7219_BACKEND MAX7219_BACKEND_BITBANG
+#define MAX7219_PORT PORTB
+#define MAX7219_PORTDD DDRB
+#define MAX7219_CLK_PIN PORTB7
+#define MAX7219_DATA_IN_PIN PORTB5
+#define MAX7219_LOAD_PIN PORTB4
+#endif // BENCH_BITBANG
+
+#include "max7219.h"
+#include "uart.h"
+
+#define BENCH_NREPEATS 64
+
+void print_P(const char *str)
+{
+	for (char c; (c = pgm_read_byte(str)); ++str) {
+		while (!uart_tx_free())
+			;
+		uart_putc(c);
+	}
+}
+
+void print_number(uint32_t number)
+{
+	char buf[11];
+	ultoa(number, buf, 10);
+	for (char *c = buf; *c; ++c) {
+		while (!uart_tx_free())
+			;
+		uart_putc(*c);
+	}
+}
+
+/* timer1 counts cpu cycles, interrupts must be disabled */
+uint16_t measure_overhead()
+{
+	TCNT1 = 0;
+	return TCNT1;
+}
+
+uint16_t measure_packet(byte_t val)
+{
+	TCNT1 = 0;
+	_max7219_send_packet(MAX7219_DIGIT0, val);
+	return TCNT1;
+}
+
+uint16_t measure_frame(byte_t val)
+{
+	TCNT1 = 0;
+	for (byte_t i = 0; i < 8; ++i)
+		max7219_setdigit(i, val ^ i);
+	return TCNT1;
+}
+
+int main()
+{
+	max7219_init_ports();
+	max7219_clear_digits();
+	max7219_set_ndigits(8);
+	max7219_set_intencity(1);
+	max7219_wakeup();
+
+	uart_init();
+	TCCR1A = 0;
+	TCCR1B = 1 << CS10; // no prescaling
+	sei();
+
+	for (byte_t iter = 0; ; ++iter) {
+		uint32_t packet = 0, frame = 0;
+
+		cli();
+		uint16_t overhead = measure_overhead();
+		for (byte_t i = 0; i < BENCH_NREPEATS; ++i) {
+			/* data changes, so bit-bang doesn't get the same bits every time */
+			packet += measure_packet(iter + i) - overhead;
+			frame += measure_frame(iter + i) - overhead;
+		}
+		sei();
+		packet /= BENCH_NREPEATS;
+		frame /= BENCH_NREPEATS;
+
+		print_P(PSTR("max7219 " MAX7219_BACKEND_NAME ": "));
+		print_number(packet);
+		print_P(PSTR(" cycles/packet, "));
+		print_number(F_CPU / packet);
+		print_P(PSTR(" packets/s, "));
+		print_number(frame);
+		print_P(PSTR(" cycles/frame, "));
+		print_number(F_CPU / frame);
+		print_P(PSTR(" frames/s\r\n"));
+		_delay_ms(1000);
+	}
+}
@@ -0,0 +1,255 @@
+#!/usr/bin/env python3
+"""Renders animations (assets/animations.txt) into delta-compressed PROGMEM tables.
+
+usage: animc.py FONT_TXT IMAGES_TXT ANIMATIONS_TXT > include/anim_assets.h
+
+Effects are rendered the same way as include/effects.h does it, from glyphs
+and images packed by assetc.py, so frames match the computed ones.
+
+Animation: 2 bytes of frame period in ms (little endian), then records:
+    [mask] rows...   mask != 0: wait one period (except before the first
+                     record), replace rows, whose bits are set in mask
+                     (bit i - row i), by the following bytes, show frame
+    [0] [n]          wait n periods, n = 0 is the end
+"""
+
+import re
+import sys
+
+from assetc import FONT_SPACE_WIDTH, IMAGE_SIZE, die, pack_glyph, pack_image, parse_blocks
+
+
+class Assets:
+    def __init__(self, font_path, images_path):
+        self.glyphs = {}
+        self.extras = {}
+        for words, art, lineno in parse_blocks(font_path, 'glyph'):
+            data = pack_glyph(art, '%s:%d' % (font_path, lineno))
+            if words[0].startswith("'"):
+                self.glyphs[words[0][1]] = data
+            else:
+                self.extras[words[1]] = data
+        self.images = {}
+        for words, art, lineno in parse_blocks(images_path, 'image'):
+            self.images[words[0]] = pack_image(art, '%s:%d' % (images_path, lineno))
+
+    def glyph(self, c):
+        """c is a char or name of extra glyph"""
+        if len(c) > 1:
+            return self.extras[c]
+        return self.glyphs.get(c.upper())
+
+    def glyph_width(self, c):
+        glyph = self.glyph(c)
+        return glyph[2] & 0x0F if glyph else FONT_SPACE_WIDTH
+
+    def draw_glyph(self, image, c, x, y):
+        """as image_draw_glyph()"""
+        glyph = self.glyph(c)
+        if not glyph:
+            return
+        rows = [glyph[0] >> 4, glyph[0] & 0x0F, glyph[1] >> 4, glyph[1] & 0x0F, glyph[2] >> 4]
+        for i, row in enumerate(rows):
+            image[y + i] = (image[y + i] | row << x) & 0xFF
+
+    def number(self, n):
+        """as image_emplace_number()"""
+        image = [0] * IMAGE_SIZE
+        if n < 10:
+            self.draw_glyph(image, str(n), 2, 2)
+        else:
+            self.draw_glyph(image, str(n % 10), 0, 2)
+            self.draw_glyph(image, str(n // 10), 5, 2)
+        return image
+
+    def image(self, name):
+        """as image_packed_row() for all rows"""
+        data = self.images[name]
+        top, height = data[0] >> 4, data[0] & 0x0F
+        shift, width = data[1] >> 4, data[1] & 0x0F
+        image = [0] * IMAGE_SIZE
+        for i in range(height):
+            if width <= 4:
+                val = data[2 + i // 2]
+                val = val & 0x0F if i & 1 else val >> 4
+            else:
+                val = data[2 + i]
+            image[top + i] = val << shift
+        return image
+
+
+class Timeline:
+    """frames by periods, as effects show them with waits in between"""
+    def __init__(self):
+        self.frames = []
+
+    def show(self, image):
+        if self.frames:
+            self.frames[-1] = list(image)
+        else:
+            self.frames.append(list(image))
+
+    def wait(self, periods=1):
+        for _ in range(periods):
+            self.frames.append(list(self.frames[-1]))
+
+    def last(self):
+        return list(self.frames[-1]) if self.frames else [0] * IMAGE_SIZE
+
+
+def shift_to_sides(timeline):
+    """as draw_effect_shift_to_sides()"""
+    image = timeline.last()
+    for _ in range(IMAGE_SIZE // 2):
+        timeline.wait()
+        image = [(0xE0 & row << 1) | (0x07 & row >> 1) for row in image]
+        timeline.show(image)
+
+
+def swap_shift_left(timeline, fst, snd):
+    """as draw_effect_swap_shift_left()"""
+    image, snd = list(fst), list(snd)
+    timeline.show(image)
+    for _ in range(IMAGE_SIZE):
+        timeline.wait()
+        image = [(row << 1 | s >> (IMAGE_SIZE - 1)) & 0xFF for row, s in zip(image, snd)]
+        snd = [s << 1 & 0xFF for s in snd]
+        timeline.show(image)
+
+
+def moving_text(timeline, assets, text):
+    """as draw_effect_moving_text(), text is a list of chars and glyph names"""
+    right = [0] * IMAGE_SIZE
+    pos = 0
+    while True:
+        left, right = right, [0] * IMAGE_SIZE
+        free_cols = IMAGE_SIZE
+        while pos < len(text):
+            width = assets.glyph_width(text[pos])
+            if width > free_cols:
+                break
+            assets.draw_glyph(right, text[pos], free_cols - width, 2)
+            free_cols -= width + 1
+            pos += 1
+        swap_shift_left(timeline, left, right)
+        if pos == len(text) and not any(right):
+            break
+
+
+def parse_text(text, assets, where):
+    chars = re.findall(r'\{(\w+)\}|(.)', text)
+    result = [name or c for name, c in chars]
+    for c in result:
+        if len(c) > 1 and c not in assets.extras:
+            die('%s: no glyph %s' % (where, c))
+    return result
+
+
+def render(steps, assets, path):
+    timeline = Timeline()
+    for words, lineno in steps:
+        where = '%s:%d' % (path, lineno)
+        step, args = words[0], words[1:]
+        if step in ('image', 'number') and timeline.frames:
+            timeline.wait()
+        if step == 'image':
+            if args[0] not in assets.images:
+                die('%s: no image %s' % (where, args[0]))
+            timeline.show(assets.image(args[0]))
+        elif step == 'number':
+            n = int(args[0])
+            if not 0 <= n <= 99:
+                die('%s: number must be from 0 to 99' % where)
+            timeline.show(assets.number(n))
+        elif step == 'hold':
+            timeline.wait(int(args[0]))
+        elif step == 'shift_to_sides':
+            shift_to_sides(timeline)
+        elif step == 'moving_text':
+            if timeline.frames:
+                timeline.wait()
+            moving_text(timeline, assets, parse_text(' '.join(args), assets, where))
+        else:
+            die('%s: unknown step %s' % (where, step))
+    if not timeline.frames:
+        die('%s: animation has no frames' % path)
+    return timeline.frames
+
+
+def encode(frames, period_ms):
+    data = [period_ms & 0xFF, period_ms >> 8]
+    prev = [0] * IMAGE_SIZE
+    hold = 0
+
+    def flush_hold():
+        nonlocal hold
+        while hold:
+            n = min(hold, 255)
+            data.extend([0, n])
+            hold -= n
+
+    for i, frame in enumerate(frames):
+        mask = sum(1 << row for row in range(IMAGE_SIZE) if frame[row] != prev[row])
+        if i == 0 and not mask:
+            mask = 0xFF  # blank first frame is shown as well
+        if i > 0 and not mask:
+            hold += 1
+            continue
+        flush_hold()
+        data.append(mask)
+        data.extend(frame[row] for row in range(IMAGE_SIZE) if mask >> row & 1)
+        prev = frame
+    flush_hold()
+    data.extend([0, 0])
+    return data
+
+
+def parse_animations(path):
+    """returns list of (name, period, steps, lineno)"""
+    anims = []
+    with open(path) as f:
+        for lineno, line in enumerate(f, 1):
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            words = line.split()
+            if words[0] == 'anim':
+                if len(words) != 3 or not words[2].isdigit() or not 0 < int(words[2]) < 0x10000:
+                    die('%s:%d: expected anim <name> <period ms>' % (path, lineno))
+                anims.append((words[1], int(words[2]), [], lineno))
+            elif not anims:
+                die('%s:%d: step outside of anim' % (path, lineno))
+            else:
+                anims[-1][2].append((words, lineno))
+    return anims
+
+
+def main():
+    if len(sys.argv) != 4:
+        die('usage: animc.py FONT_TXT IMAGES_TXT ANIMATIONS_TXT')
+    assets = Assets(sys.argv[1], sys.argv[2])
+    out = [
+        '/* Generated by tools/animc.py from %s, do not edit.' % sys.argv[3],
+        ' * Included from anim.h */',
+        '',
+        '#ifndef ANIM_ASSETS_H_',
+        '#define ANIM_ASSETS_H_',
+    ]
+    for name, period, steps, lineno in parse_animations(sys.argv[3]):
+        frames = render(steps, assets, sys.argv[3])
+        data = encode(frames, period)
+        out.append('')
+        out.append('#ifdef ANIM_USING_%s' % name.upper())
+        out.append('\t// %d frames by %d ms, %d bytes' % (len(frames), period, len(data)))
+        out.append('\tcanim_t anim_%s PROGMEM = {' % name)
+        for i in range(0, len(data), 12):
+            out.append('\t\t%s,' % ', '.join('0x%02X' % b for b in data[i:i + 12]))
+        out.append('\t};')
+        out.append('#endif')
+    out.append('')
+    out.append('#endif // ANIM_ASSETS_H_')
+    print('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,186 @@
+#!/usr/bin/env python3
+"""Converts font and image art (assets/*.txt) into packed PROGMEM tables.
+
+usage: assetc.py FONT_TXT IMAGES_TXT > include/drawing_assets.h
+
+Font glyph, 3 bytes: rows are 4-bit nibbles, right aligned, with empty
+columns trimmed; the last nibble is the glyph width.
+    [row0 << 4 | row1] [row2 << 4 | row3] [row4 << 4 | width]
+
+Image: 2 bytes of header, then rows top .. top + height - 1, shifted right
+by shift. Rows are packed two per byte (high nibble first) if width <= 4,
+one per byte otherwise.
+    [top << 4 | height] [shift << 4 | width] rows...
+"""
+
+import sys
+
+FONT_HEIGHT = 5
+FONT_MAX_WIDTH = 4
+IMAGE_SIZE = 8
+FONT_SPACE_WIDTH = 2  # as in drawing.h
+LETTERS_ONLY_BEFORE = '0'  # chars before digits are included only with letters
+
+
+def die(msg):
+    sys.exit('assetc: ' + msg)
+
+
+def parse_blocks(path, keyword):
+    """yields (header words, art lines) for every block"""
+    blocks = []
+    with open(path) as f:
+        for lineno, line in enumerate(f, 1):
+            line = line.strip()
+            if not line or line.startswith('#') and not set(line) <= {'#', '.'}:
+                continue
+            if line.startswith(keyword + ' '):
+                blocks.append((line.split()[1:], [], lineno))
+            elif set(line) <= {'#', '.'}:
+                if not blocks:
+                    die('%s:%d: art outside of %s' % (path, lineno, keyword))
+                blocks[-1][1].append(line)
+            else:
+                die('%s:%d: unexpected line' % (path, lineno))
+    return blocks
+
+
+def art_to_bits(art):
+    """rows as integers, leftmost art column is the highest bit"""
+    width = max(len(row) for row in art)
+    return [int(row.ljust(width, '.').replace('#', '1').replace('.', '0'), 2) for row in art], width
+
+
+def pack_glyph(art, where):
+    if len(art) != FONT_HEIGHT:
+        die('%s: glyph must be %d rows high' % (where, FONT_HEIGHT))
+    rows, width = art_to_bits(art)
+    used = 0
+    for row in rows:
+        used |= row
+    if used:
+        shift = (used & -used).bit_length() - 1  # empty columns on the right
+        rows = [row >> shift for row in rows]
+        width = (used >> shift).bit_length()
+    if width > FONT_MAX_WIDTH:
+        die('%s: glyph is wider than %d columns' % (where, FONT_MAX_WIDTH))
+    return [rows[0] << 4 | rows[1], rows[2] << 4 | rows[3], rows[4] << 4 | width]
+
+
+def pack_image(art, where):
+    if len(art) != IMAGE_SIZE or any(len(row) != IMAGE_SIZE for row in art):
+        die('%s: image must be %dx%d' % (where, IMAGE_SIZE, IMAGE_SIZE))
+    rows, _ = art_to_bits(art)
+    nonempty = [i for i, row in enumerate(rows) if row]
+    if not nonempty:
+        return [0, 0]
+    top, bottom = nonempty[0], nonempty[-1]
+    rows = rows[top:bottom + 1]
+    used = 0
+    for row in rows:
+        used |= row
+    shift = (used & -used).bit_length() - 1
+    rows = [row >> shift for row in rows]
+    width = (used >> shift).bit_length()
+
+    data = [top << 4 | len(rows), shift << 4 | width]
+    if width <= 4:
+        if len(rows) % 2:
+            rows.append(0)
+        data += [rows[i] << 4 | rows[i + 1] for i in range(0, len(rows), 2)]
+    else:
+        data += rows
+    return data
+
+
+def char_literal(code):
+    c = chr(code)
+    return "'\\''" if c == "'" else "'\\\\'" if c == '\\' else "'%s'" % c
+
+
+def hex_bytes(data):
+    return ', '.join('0x%02X' % b for b in data)
+
+
+def emit_font(path, out):
+    glyphs = {}
+    extras = []
+    for words, art, lineno in parse_blocks(path, 'glyph'):
+        where = '%s:%d' % (path, lineno)
+        if words[0].startswith("'"):
+            glyphs[ord(words[0][1])] = pack_glyph(art, where)
+        else:
+            extras.append((int(words[0], 0), words[1], pack_glyph(art, where)))
+
+    digits = range(ord('0'), ord('9') + 1)
+    if any(code not in glyphs for code in digits):
+        die('%s: all digits must be defined' % path)
+    first = min(glyphs)
+    last = max(glyphs)
+    extras.sort()
+    if any(code != 0x80 + i for i, (code, _, _) in enumerate(extras)):
+        die('%s: extra glyphs must have consecutive codes from 0x80' % path)
+
+    out.append('#if defined(DRAWING_USING_NUMBERS) || defined(DRAWING_USING_LETTERS)')
+    out.append('#ifdef DRAWING_USING_LETTERS')
+    out.append('\t#define FONT_FIRST_CHAR %s' % char_literal(first))
+    out.append('\t#define FONT_LAST_CHAR %s' % char_literal(last))
+    out.append('\t#define FONT_NEXTRA %d // glyphs from 0x80' % len(extras))
+    for code, name, _ in extras:
+        out.append('\t#define FONT_CHAR_%s "\\x%02X"' % (name, code))
+    out.append('#else')
+    out.append("\t#define FONT_FIRST_CHAR '0'")
+    out.append("\t#define FONT_LAST_CHAR '9'")
+    out.append('\t#define FONT_NEXTRA 0')
+    out.append('#endif')
+    out.append('')
+    out.append('\tconst font_glyph_t font_glyphs[] PROGMEM = {')
+
+    def emit_range(codes):
+        for code in codes:
+            # characters without glyph inside the range are drawn as space
+            data = glyphs.get(code, [0, 0, FONT_SPACE_WIDTH])
+            out.append('\t\t{ %s }, // %s' % (hex_bytes(data), char_literal(code)))
+
+    out.append('#ifdef DRAWING_USING_LETTERS')
+    emit_range(range(first, ord('0')))
+    out.append('#endif')
+    emit_range(digits)
+    out.append('#ifdef DRAWING_USING_LETTERS')
+    emit_range(range(ord('9') + 1, last + 1))
+    for code, name, data in extras:
+        out.append('\t\t{ %s }, // 0x%02X %s' % (hex_bytes(data), code, name))
+    out.append('#endif')
+    out.append('\t};')
+    out.append('#endif')
+
+
+def emit_images(path, out):
+    out.append('#ifdef DRAWING_USING_COMMON_IMAGES')
+    for words, art, lineno in parse_blocks(path, 'image'):
+        data = pack_image(art, '%s:%d' % (path, lineno))
+        out.append('\tcpacked_image_t prog_img_%s PROGMEM = { %s };' % (words[0], hex_bytes(data)))
+    out.append('#endif // DRAWING_USING_COMMON_IMAGES')
+
+
+def main():
+    if len(sys.argv) != 3:
+        die('usage: assetc.py FONT_TXT IMAGES_TXT')
+    out = [
+        '/* Generated by tools/assetc.py from %s and %s, do not edit.' % tuple(sys.argv[1:]),
+        ' * Included from drawing.h */',
+        '',
+        '#ifndef DRAWING_ASSETS_H_',
+        '#define DRAWING_ASSETS_H_',
+        '',
+    ]
+    emit_font(sys.argv[1], out)
+    out.append('')
+    emit_images(sys.argv[2], out)
+    out.append('')
+    out.append('#endif // DRAWING_ASSETS_H_')
+    print('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()
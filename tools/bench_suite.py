@@ -0,0 +1,244 @@
+#!/usr/bin/env python3
+"""Flash, RAM and cycle costs of the firmware across build configurations.
+
+Every configuration changes one thing against the baseline (-Os, no LTO,
+no section GC, 8x8 board, MAX_SNAKE_LENGTH 64, no extra macros), --full
+builds all combinations instead. For every configuration:
+ - game_bench.c is built for atmega8535 and its sections are measured
+   with avr-size, then it is built for the simulated mcu and run in simavr,
+   which gives cycles per tick, frame and rabbit placement
+ - main.c is built and measured, if configuration changes only compiler
+   flags (main.c sets board and drawing macros itself)
+Results are written as tab-separated table, tables of two commits are
+compared with --compare.
+
+usage:
+    bench_suite.py [-o results.tsv] [--full] [-j JOBS]
+    bench_suite.py --compare old.tsv new.tsv
+
+simavr has no atmega8535 core, atmega16 has the same cpu core and
+peripherals, so cycles are measured on it (--sim-mcu to change).
+"""
+
+import argparse
+import concurrent.futures
+import itertools
+import os
+import re
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+MCU = 'atmega8535'
+F_CPU = 1000000
+BASE_FLAGS = ['-std=gnu99', '-DF_CPU=%d' % F_CPU, '-I', os.path.join(ROOT, 'include')]
+
+BASELINE = {'opt': '-Os', 'lto': False, 'gc': False, 'board': (8, 8), 'length': 64, 'macro': None}
+VARIANTS = {
+    'opt': ['-O1', '-O2', '-O3'],
+    'lto': [True],
+    'gc': [True],
+    'board': [(16, 8), (16, 15)],
+    'length': [32, 128],
+    'macro': ['DRAWING_USING_COMMON_IMAGES', 'DRAWING_USING_LETTERS',
+              'SNAKE_GAME_NO_WRAP', 'SNAKE_GAME_REWIND_DEPTH=16'],
+}
+# only these keys may be changed for main.c
+FLAG_KEYS = ('opt', 'lto', 'gc')
+
+SIZE_COLUMNS = ['flash', 'data', 'bss']
+CYCLE_COLUMNS = ['tick_avg', 'tick_max', 'frame_avg', 'rabbit_avg', 'rabbit_max']
+COLUMNS = (['config'] + ['main_' + c for c in SIZE_COLUMNS]
+           + ['bench_' + c for c in SIZE_COLUMNS] + CYCLE_COLUMNS)
+
+
+def config_name(cfg):
+    parts = [cfg['opt'][1:]]
+    if cfg['lto']:
+        parts.append('lto')
+    if cfg['gc']:
+        parts.append('gc')
+    if cfg['board'] != BASELINE['board']:
+        parts.append('%dx%d' % cfg['board'])
+    if cfg['length'] != BASELINE['length']:
+        parts.append('len%d' % cfg['length'])
+    if cfg['macro']:
+        parts.append(cfg['macro'])
+    return '+'.join(parts)
+
+
+def configurations(full):
+    if full:
+        axes = [[BASELINE[k]] + VARIANTS[k] for k in BASELINE]
+        for values in itertools.product(*axes):
+            cfg = dict(zip(BASELINE, values))
+            if cfg['length'] <= cfg['board'][0] * cfg['board'][1]:
+                yield cfg
+        return
+    yield dict(BASELINE)
+    for key, values in VARIANTS.items():
+        for value in values:
+            cfg = dict(BASELINE)
+            cfg[key] = value
+            yield cfg
+
+
+def compiler_flags(cfg):
+    flags = [cfg['opt']]
+    if cfg['lto']:
+        flags.append('-flto')
+    if cfg['gc']:
+        flags += ['-ffunction-sections', '-fdata-sections', '-Wl,--gc-sections']
+    return flags
+
+
+def game_macros(cfg):
+    macros = ['-DSNAKE_GAME_WIDTH=%d' % cfg['board'][0], '-DSNAKE_GAME_HEIGHT=%d' % cfg['board'][1],
+              '-DMAX_SNAKE_LENGTH=%d' % cfg['length']]
+    if cfg['macro']:
+        macros.append('-D' + cfg['macro'])
+    return macros
+
+
+def build(source, elf, mcu, flags, args):
+    os.makedirs(os.path.dirname(elf), exist_ok=True)
+    cmd = [args.cc, '-mmcu=' + mcu] + BASE_FLAGS + flags + ['-o', elf, os.path.join(ROOT, source)]
+    res = subprocess.run(cmd, capture_output=True, text=True)
+    if res.returncode != 0:
+        raise RuntimeError('%s failed:\n%s' % (' '.join(cmd), res.stderr))
+
+
+def section_sizes(elf, args):
+    """flash is .text + .data (initializers are stored in flash)"""
+    out = subprocess.run([args.size, '-A', elf], capture_output=True, text=True, check=True).stdout
+    sections = {}
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[0].startswith('.') and fields[1].isdigit():
+            sections[fields[0]] = int(fields[1])
+    data = sections.get('.data', 0)
+    return {'flash': sections.get('.text', 0) + data, 'data': data,
+            'bss': sections.get('.bss', 0) + sections.get('.noinit', 0)}
+
+
+def simulate(elf, args):
+    cmd = [args.simavr, '-m', args.sim_mcu, '-f', str(F_CPU), elf]
+    try:
+        res = subprocess.run(cmd, capture_output=True, text=True, timeout=args.timeout)
+        output = res.stdout + res.stderr
+    except subprocess.TimeoutExpired as e:
+        output = (e.stdout or b'').decode(errors='replace') if isinstance(e.stdout, bytes) else (e.stdout or '')
+    match = re.search(r'bench ((?:\w+=\d+ ?)+)', output)
+    if not match:
+        raise RuntimeError('%s: no result in simulator output:\n%s' % (elf, output[-500:]))
+    return {k: int(v) for k, v in (pair.split('=') for pair in match.group(1).split())}
+
+
+def run_config(cfg, args):
+    name = config_name(cfg)
+    out_dir = os.path.join(args.build_dir, name)
+    row = {'config': name}
+
+    if all(cfg[k] == BASELINE[k] for k in BASELINE if k not in FLAG_KEYS):
+        elf = os.path.join(out_dir, 'main.elf')
+        build('main.c', elf, MCU, compiler_flags(cfg), args)
+        row.update({'main_' + k: v for k, v in section_sizes(elf, args).items()})
+
+    flags = compiler_flags(cfg) + game_macros(cfg)
+    elf = os.path.join(out_dir, 'game_bench.elf')
+    build('game_bench.c', elf, MCU, flags, args)
+    row.update({'bench_' + k: v for k, v in section_sizes(elf, args).items()})
+
+    sim_elf = os.path.join(out_dir, 'game_bench_sim.elf')
+    build('game_bench.c', sim_elf, args.sim_mcu, flags, args)
+    cycles = simulate(sim_elf, args)
+    row.update({k: cycles.get(k, '') for k in CYCLE_COLUMNS})
+    return row
+
+
+def git_describe():
+    try:
+        return subprocess.run(['git', '-C', ROOT, 'describe', '--always', '--dirty'],
+                              capture_output=True, text=True, check=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return 'unknown'
+
+
+def read_table(path):
+    rows = {}
+    columns = None
+    with open(path) as f:
+        for line in f:
+            if line.startswith('#') or not line.strip():
+                continue
+            fields = line.rstrip('\n').split('\t')
+            if columns is None:
+                columns = fields
+            else:
+                rows[fields[0]] = dict(zip(columns, fields))
+    return columns or [], rows
+
+
+def compare(old_path, new_path):
+    _, old = read_table(old_path)
+    columns, new = read_table(new_path)
+    metrics = [c for c in columns if c != 'config']
+    print('config\t' + '\t'.join(metrics))
+    for name, row in new.items():
+        cells = []
+        for metric in metrics:
+            before = old.get(name, {}).get(metric, '')
+            after = row.get(metric, '')
+            if not before or not after:
+                cells.append(after or '-')
+            elif before == after:
+                cells.append(after)
+            else:
+                diff = int(after) - int(before)
+                pct = ' %+.1f%%' % (100.0 * diff / int(before)) if int(before) else ''
+                cells.append('%s (%+d%s)' % (after, diff, pct))
+        print(name + '\t' + '\t'.join(cells))
+    for name in old:
+        if name not in new:
+            print(name + '\tremoved')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('-o', '--output', help='table file, default is stdout')
+    parser.add_argument('--full', action='store_true', help='all combinations of variants')
+    parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count() or 1)
+    parser.add_argument('--compare', nargs=2, metavar=('OLD', 'NEW'))
+    parser.add_argument('--build-dir', default=os.path.join(ROOT, 'build', 'bench'))
+    parser.add_argument('--sim-mcu', default='atmega16')
+    parser.add_argument('--timeout', type=float, default=60, help='seconds per simulation')
+    parser.add_argument('--cc', default='avr-gcc')
+    parser.add_argument('--size', default='avr-size')
+    parser.add_argument('--simavr', default='simavr')
+    args = parser.parse_args()
+
+    if args.compare:
+        compare(*args.compare)
+        return
+
+    configs = list(configurations(args.full))
+    with concurrent.futures.ThreadPoolExecutor(args.jobs) as pool:
+        futures = [pool.submit(run_config, cfg, args) for cfg in configs]
+        rows = []
+        for future in futures:
+            try:
+                rows.append(future.result())
+            except (RuntimeError, OSError, subprocess.CalledProcessError) as e:
+                sys.exit('bench_suite: %s' % e)
+
+    out = open(args.output, 'w') if args.output else sys.stdout
+    out.write('# %s, mcu %s, simulated on %s at %d Hz\n' % (git_describe(), MCU, args.sim_mcu, F_CPU))
+    out.write('\t'.join(COLUMNS) + '\n')
+    for row in rows:
+        out.write('\t'.join(str(row.get(c, '')) for c in COLUMNS) + '\n')
+    if args.output:
+        out.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""Dumps the flight recorder of the snake game and prints a timeline.
+
+Record format is described in include/flightrec.h, frames are received
+with the same code as in snake_client.py.
+
+usage:
+    flightrec_decode.py -p PORT              dump and decode
+    flightrec_decode.py -p PORT --freeze     freeze recording now, then dump
+    flightrec_decode.py -p PORT --unfreeze   clear the ring and record again
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+from snake_client import Device, DIR_NAMES, MSG_FLIGHTREC, CMD_FLIGHTREC
+
+OP_DUMP, OP_FREEZE, OP_UNFREEZE = 0, 1, 2
+
+EVENTS = {1: 'tick_start', 2: 'tick_end', 3: 'dir', 4: 'rabbit', 5: 'flush',
+          6: 'button', 7: 'game_over', 8: 'trigger'}
+BUTTON_EVENTS = {0: 'pressed', 1: 'released', 2: 'long_pressed'}
+
+
+def receive_records(dev, timeout=5.0):
+    """returns list of (type, arg, ticks, counter), oldest first"""
+    records = {}
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        for msg_type, payload in dev.receive_raw(0.5):
+            if msg_type != MSG_FLIGHTREC or not payload:
+                continue
+            if len(payload) == 1:  # end marker with number of records
+                return [records[i] for i in sorted(records) if i < payload[0]]
+            for i, pos in enumerate(range(1, len(payload) - 4, 5)):
+                records[payload[0] + i] = struct.unpack('<BBHB', payload[pos:pos + 5])
+    sys.exit('flightrec_decode: no answer')
+
+
+def to_timeline(records, tick_us, counter_us):
+    """converts (ticks, counter) to microseconds from the first record,
+    unwrapping 16-bit ticks and fixing ticks, which were pending"""
+    result = []
+    base = None
+    wraps = 0
+    prev_ticks = None
+    prev_us = None
+    for rec_type, arg, ticks, counter in records:
+        if prev_ticks is not None and ticks < prev_ticks and prev_ticks - ticks > 0x8000:
+            wraps += 1
+        prev_ticks = ticks
+        us = ((wraps << 16) + ticks) * tick_us + counter * counter_us
+        if prev_us is not None and prev_us - tick_us <= us < prev_us:
+            us += tick_us  # systick interrupt was pending, when event was recorded
+        if base is None:
+            base = us
+        result.append((us - base, rec_type, arg))
+        prev_us = us
+    return result
+
+
+def describe(rec_type, arg, width):
+    name = EVENTS.get(rec_type, 'type%d' % rec_type)
+    if name == 'dir':
+        return name, DIR_NAMES.get(struct.unpack('b', bytes([arg]))[0], arg)
+    if name == 'rabbit':
+        return name, 'x=%d y=%d' % (arg % width, arg // width)
+    if name == 'button':
+        return name, '%s pin %d' % (BUTTON_EVENTS.get(arg >> 4, arg >> 4), arg & 0x0F)
+    if name == 'flush':
+        return name, '%d rows' % arg if arg else 'deferred'
+    return name, str(arg)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('-p', '--port', required=True)
+    parser.add_argument('--baud', type=int, default=9600)
+    parser.add_argument('--freeze', action='store_true')
+    parser.add_argument('--unfreeze', action='store_true')
+    parser.add_argument('--width', type=int, default=8, help='board width for rabbit cells')
+    parser.add_argument('--tick-us', type=int, default=2000, help='systick period')
+    parser.add_argument('--counter-us', type=int, default=8, help='TCNT0 period')
+    args = parser.parse_args()
+
+    dev = Device(args.port, args.baud)
+    if args.unfreeze:
+        dev.send(CMD_FLIGHTREC, bytes([OP_UNFREEZE]))
+        return
+    if args.freeze:
+        dev.send(CMD_FLIGHTREC, bytes([OP_FREEZE]))
+    dev.send(CMD_FLIGHTREC, bytes([OP_DUMP]))
+
+    timeline = to_timeline(receive_records(dev), args.tick_us, args.counter_us)
+    print('%10s %9s  %-11s %s' % ('time_ms', 'delta_ms', 'event', 'arg'))
+    prev = 0
+    for us, rec_type, arg in timeline:
+        name, text = describe(rec_type, arg, args.width)
+        print('%10.3f %9.3f  %-11s %s' % (us / 1000, (us - prev) / 1000, name, text))
+        prev = us
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,129 @@
+/* Measures cost of snake_arena_update() for growing number of snakes
+ *  Snakes are driven by a simple bot: go ahead, turn if the next cell is
+ * taken, sometimes turn at random. Games are restarted, when half of snakes
+ * are dead, so the number of alive snakes stays close to the nominal one.
+ * Bot time is not counted. Before that two one-cell snakes are sent head-on
+ * to check, that they die, when they swap cells.
+ *  usage: arena_bench [-t ticks] [-s seed]
+ *   -t  ticks per number of snakes (default 100000)
+ *  Board size is set at compile time with -DBENCH_WIDTH=... -DBENCH_HEIGHT=...,
+ * default is 64x64
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef BENCH_WIDTH
+#define BENCH_WIDTH 64
+#endif
+#ifndef BENCH_HEIGHT
+#define BENCH_HEIGHT 64
+#endif
+
+#define SNAKE_ARENA_WIDTH BENCH_WIDTH
+#define SNAKE_ARENA_HEIGHT BENCH_HEIGHT
+#define SNAKE_ARENA_MAX_SNAKES 64
+#define SNAKE_ARENA_MAX_LENGTH 256
+#include "snake_arena.h"
+
+static snake_arena_t arena;
+static snake_dir_t dirs[SNAKE_ARENA_MAX_SNAKES];
+
+static long long now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static bool_t is_free_ahead(const arena_snake_t *s, snake_dir_t dir)
+{
+	arena_cell_t next = snake_arena_next_cell(snake_arena_head(s), dir);
+	return next != ARENA_CELL_NONE && !ARENA_BIT(arena.occupied, next) && !ARENA_BIT(arena.walls, next);
+}
+
+static void steer(uint16_t *rng)
+{
+	for (byte_t i = 0; i < arena.nsnakes; ++i) {
+		const arena_snake_t *s = &arena.snakes[i];
+		dirs[i] = DIR_UNKNOWN;
+		if (s->death != ARENA_ALIVE)
+			continue;
+
+		/* turns are perpendicular to the current direction */
+		snake_dir_t turn = (s->dir == DIR_UP || s->dir == DIR_DOWN) ? DIR_LEFT : DIR_UP;
+		if (snake_random(rng) & 1)
+			turn = -turn;
+		if (!is_free_ahead(s, s->dir) || (snake_random(rng) & 7) == 0)
+			dirs[i] = is_free_ahead(s, turn) ? turn : -turn;
+	}
+}
+
+/*  Snakes start at the same row at even distance, the wall moves the first
+ * one a cell further, so they meet swapping cells instead of in one cell */
+static bool_t check_head_swap()
+{
+	arena_cell_t wall = ARENA_CELL(SNAKE_ARENA_WIDTH / 4, SNAKE_ARENA_HEIGHT / 2); // start of the first snake
+	memset(&arena, 0, sizeof arena);
+	arena.seed = 1;
+	arena.walls[wall >> 3] |= 1 << (wall & 7);
+	snake_arena_init(&arena, 2, 0);
+	dirs[0] = DIR_RIGHT;
+	dirs[1] = DIR_LEFT;
+	for (int t = 0; t < SNAKE_ARENA_WIDTH && arena.nalive == 2; ++t)
+		snake_arena_update(&arena, dirs);
+	bool_t ok = arena.snakes[0].death == ARENA_DIED_HEAD && arena.snakes[1].death == ARENA_DIED_HEAD;
+	memset(&arena, 0, sizeof arena);
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	long nticks = 100000;
+	uint16_t seed = 1;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:s:")) != -1) {
+		switch (opt) {
+		case 't': nticks = atol(optarg); break;
+		case 's': seed = atoi(optarg) ? atoi(optarg) : 1; break;
+		default:
+			fprintf(stderr, "usage: %s [-t ticks] [-s seed]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!check_head_swap()) {
+		fprintf(stderr, "arena_bench: snakes, which swap cells, don't die\n");
+		return EXIT_FAILURE;
+	}
+	printf("board %dx%d, %zu bytes per arena\n", SNAKE_ARENA_WIDTH, SNAKE_ARENA_HEIGHT, sizeof arena);
+	printf("%7s %9s %9s %11s %13s\n", "snakes", "games", "alive", "ns/tick", "ns/snake-tick");
+	for (int nsnakes = 1; nsnakes <= SNAKE_ARENA_MAX_SNAKES; nsnakes *= 2) {
+		uint16_t rng = seed;
+		long long total_ns = 0, alive_ticks = 0;
+		long ngames = 1;
+
+		arena.seed = seed;
+		snake_arena_init(&arena, nsnakes, nsnakes);
+		for (long t = 0; t < nticks; ++t) {
+			if (arena.nalive <= nsnakes / 2) {
+				snake_arena_init(&arena, nsnakes, nsnakes);
+				++ngames;
+			}
+			steer(&rng);
+			alive_ticks += arena.nalive;
+
+			long long start = now_ns();
+			snake_arena_update(&arena, dirs);
+			total_ns += now_ns() - start;
+		}
+		printf("%7d %9ld %9.1f %11.1f %13.1f\n", nsnakes, ngames, (double) alive_ticks / nticks,
+			(double) total_ns / nticks, alive_ticks ? (double) total_ns / alive_ticks : 0.0);
+	}
+	return EXIT_SUCCESS;
+}
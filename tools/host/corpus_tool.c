@@ -0,0 +1,256 @@
+/* Fills, queries and replays corpora of recorded games (game_corpus.h)
+ *  usage:
+ *   corpus_tool gen [-n games] [-s seed] [-l level] PATH
+ *       appends games of a bot (goes to the rabbit by the shortest way on the
+ *       torus, avoids its body, sometimes turns at random)
+ *   corpus_tool query [-j threads] [-m min_score] [-d death] [-w] [-a ticks] [-v] PATH
+ *       prints number of games with score >= min_score, death cause
+ *       (alive, self, wall, border), at least one wrap-around (-w) or death
+ *       within ticks after the last wrap-around (-a), and the first of them.
+ *       -v replays every found game and checks it against the index
+ *   corpus_tool replay PATH N
+ *       replays game N and prints the board after every tick
+ *  E.g. games, which died at score > 40 after a wrap-around:
+ *   corpus_tool query -m 41 -d self -w PATH
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_SNAKE_LENGTH 64
+#define SNAKE_GAME_WIDTH 8
+#define SNAKE_GAME_HEIGHT 8
+#include "snake_game.h"
+#include "levels.h"
+#include "game_corpus.h"
+
+#define NSHOWN 10 // games printed by query
+
+typedef struct {
+	unsigned int min_score;
+	int death; // corpus_death_t, -1 for any
+	bool_t is_wrapped;
+	uint32_t max_after_wrap; // 0 - any
+} filter_t;
+
+static const char *death_names[] = { "alive", "self", "wall", "border" };
+
+static long long now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*  xorshift of the bot: the 16-bit one of the engine, shared by the bot and
+ * seeds, would repeat the same games after a few hundred */
+static uint32_t bot_random(uint32_t *state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+static cell_idx_t next_cell(cell_idx_t cell, snake_dir_t dir)
+	{ return pgm_read_byte(&_snake_next_cell_wrapped[cell][_SNAKE_DIR_IDX(dir)]); }
+
+static int wrap_delta(int src, int dst, int size)
+{
+	int delta = ((dst - src) % size + size) % size;
+	return delta > size / 2 ? delta - size : delta;
+}
+
+/* as choose_dir() of snake_client.py, but doesn't run into itself */
+static snake_dir_t choose_dir(const snake_game_t *game, uint32_t *rng)
+{
+	const snake_t *s = &game->snake;
+	cell_idx_t head = s->segments[s->head];
+	int dx = wrap_delta(SNAKE_CELL_X(head), SNAKE_CELL_X(game->rabbit), SNAKE_GAME_WIDTH);
+	int dy = wrap_delta(SNAKE_CELL_Y(head), SNAKE_CELL_Y(game->rabbit), SNAKE_GAME_HEIGHT);
+	snake_dir_t wanted[4] = {
+		dx > 0 ? DIR_RIGHT : DIR_LEFT, dy > 0 ? DIR_DOWN : DIR_UP,
+		dx > 0 ? DIR_LEFT : DIR_RIGHT, dy > 0 ? DIR_UP : DIR_DOWN
+	};
+	if (!dx || (dy && (bot_random(rng) & 1))) { // the other axis first
+		snake_dir_t t = wanted[0]; wanted[0] = wanted[1]; wanted[1] = t;
+	}
+	if ((bot_random(rng) & 15) == 0) // explore
+		wanted[0] = wanted[2 + (bot_random(rng) & 1)];
+	for (byte_t i = 0; i < 4; ++i) {
+		cell_idx_t next = next_cell(head, wanted[i]);
+		if (wanted[i] != -s->dir && MAP_ELEM(game->map, next) != CELL_SNAKE && !WALL_ELEM(game->walls, next))
+			return wanted[i];
+	}
+	return DIR_UNKNOWN;
+}
+
+static int generate(const char *path, unsigned long ngames, uint16_t seed, byte_t level)
+{
+	corpus_writer_t w;
+	if (!corpus_writer_open(&w, path)) {
+		perror("corpus_tool: open");
+		return EXIT_FAILURE;
+	}
+	corpus_journal_t j;
+	corpus_journal_init(&j);
+	snake_game_t game;
+	uint32_t rng = seed ? seed : 1;
+
+	long long start = now_ns();
+	for (unsigned long i = 0; i < ngames; ++i) {
+		game.seed = bot_random(&rng) >> 16 | 1;
+		game.spawn_mode = SPAWN_RANDOM;
+		corpus_game_start(&j, &game, level);
+		while (!game.is_finished && game.score < SNAKE_NCELLS - 1) // the last rabbit would have no room
+			if (!corpus_game_update(&j, &game, choose_dir(&game, &rng))) {
+				perror("corpus_tool");
+				return EXIT_FAILURE;
+			}
+		if (!corpus_append(&w, &j)) {
+			perror("corpus_tool: write");
+			return EXIT_FAILURE;
+		}
+	}
+	printf("%lu games appended in %.2f s\n", ngames, (now_ns() - start) / 1e9);
+	corpus_journal_free(&j);
+	corpus_writer_close(&w);
+	return EXIT_SUCCESS;
+}
+
+static bool_t filter_match(const corpus_entry_t *e, const void *arg)
+{
+	const filter_t *f = arg;
+	return e->score >= f->min_score
+		&& (f->death < 0 || e->death == f->death)
+		&& (!f->is_wrapped || e->last_wrap)
+		&& (!f->max_after_wrap || (e->last_wrap && e->length - e->last_wrap <= f->max_after_wrap));
+}
+
+static int query(const char *path, const filter_t *f, int nthreads, bool_t is_verified)
+{
+	corpus_t c;
+	if (!corpus_open(&c, path)) {
+		fprintf(stderr, "corpus_tool: can't open corpus %s\n", path);
+		return EXIT_FAILURE;
+	}
+	uint32_t *found = malloc((c.ngames ? c.ngames : 1) * sizeof *found);
+	long long start = now_ns();
+	size_t nfound = corpus_query(&c, filter_match, f, found, nthreads);
+	double seconds = (now_ns() - start) / 1e9;
+	printf("%zu of %zu games match, %.1f ms with %d threads (%.0f M games/s)\n",
+		nfound, c.ngames, seconds * 1e3, nthreads, c.ngames / seconds / 1e6);
+
+	for (size_t i = 0; i < nfound && i < NSHOWN; ++i) {
+		const corpus_entry_t *e = &c.index[found[i]];
+		printf("  #%u: score %u, %u ticks, %s, %u wraps, last at tick %u, seed %u, level %u\n",
+			found[i], e->score, e->length, death_names[e->death & 3], e->nwraps,
+			e->last_wrap ? e->last_wrap - 1 : 0, e->seed, e->level);
+	}
+
+	int res = EXIT_SUCCESS;
+	if (is_verified) {
+		snake_game_t game;
+		size_t nbad = 0;
+		start = now_ns();
+		for (size_t i = 0; i < nfound; ++i)
+			nbad += !corpus_replay(&c, found[i], &game, NULL, NULL);
+		printf("replayed %zu games in %.2f s, %zu differ from the index\n",
+			nfound, (now_ns() - start) / 1e9, nbad);
+		res = nbad ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+	free(found);
+	corpus_close(&c);
+	return res;
+}
+
+static void print_board(const snake_game_t *game, uint32_t tick, void *arg)
+{
+	(void) arg;
+	printf("tick %u, score %u%s\n", tick, game->score, game->is_finished ? ", game over" : "");
+	for (byte_t y = 0; y < SNAKE_GAME_HEIGHT; ++y) {
+		for (byte_t x = 0; x < SNAKE_GAME_WIDTH; ++x) {
+			cell_idx_t cell = SNAKE_CELL(x, y);
+			putchar(cell == game->snake.segments[game->snake.head] ? '@'
+				: MAP_ELEM(game->map, cell) == CELL_SNAKE ? 'o'
+				: MAP_ELEM(game->map, cell) == CELL_RABBIT ? '*'
+				: WALL_ELEM(game->walls, cell) ? '#' : '.');
+		}
+		putchar('\n');
+	}
+}
+
+static int replay(const char *path, unsigned long n)
+{
+	corpus_t c;
+	if (!corpus_open(&c, path)) {
+		fprintf(stderr, "corpus_tool: can't open corpus %s\n", path);
+		return EXIT_FAILURE;
+	}
+	if (n >= c.ngames) {
+		fprintf(stderr, "corpus_tool: there are %zu games\n", c.ngames);
+		return EXIT_FAILURE;
+	}
+	snake_game_t game;
+	bool_t ok = corpus_replay(&c, n, &game, print_board, NULL);
+	if (!ok)
+		printf("replay differs from the index\n");
+	corpus_close(&c);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+		goto usage;
+	const char *cmd = argv[1];
+	unsigned long ngames = 100000;
+	uint16_t seed = 1;
+	byte_t level = 0;
+	filter_t filter = { .min_score = 0, .death = -1 };
+	int nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	bool_t is_verified = false;
+	int opt;
+
+	--argc;
+	++argv;
+	while ((opt = getopt(argc, argv, "n:s:l:j:m:d:wa:v")) != -1) {
+		switch (opt) {
+		case 'n': ngames = strtoul(optarg, NULL, 0); break;
+		case 's': seed = atoi(optarg); break;
+		case 'l': level = atoi(optarg); break;
+		case 'j': nthreads = atoi(optarg); break;
+		case 'm': filter.min_score = atoi(optarg); break;
+		case 'd':
+			for (filter.death = ARR_SZ(death_names) - 1; filter.death >= 0; --filter.death)
+				if (!strcmp(optarg, death_names[filter.death]))
+					break;
+			if (filter.death < 0)
+				goto usage;
+			break;
+		case 'w': filter.is_wrapped = true; break;
+		case 'a': filter.max_after_wrap = atoi(optarg); break;
+		case 'v': is_verified = true; break;
+		default:
+			goto usage;
+		}
+	}
+
+	if (!strcmp(cmd, "gen") && optind + 1 == argc)
+		return generate(argv[optind], ngames, seed, level);
+	if (!strcmp(cmd, "query") && optind + 1 == argc)
+		return query(argv[optind], &filter, nthreads, is_verified);
+	if (!strcmp(cmd, "replay") && optind + 2 == argc)
+		return replay(argv[optind], strtoul(argv[optind + 1], NULL, 0));
+
+usage:
+	fprintf(stderr, "usage: corpus_tool gen [-n games] [-s seed] [-l level] PATH\n"
+		"       corpus_tool query [-j threads] [-m min_score] [-d alive|self|wall|border] [-w] [-a ticks] [-v] PATH\n"
+		"       corpus_tool replay PATH N\n");
+	return EXIT_FAILURE;
+}
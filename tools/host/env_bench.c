@@ -0,0 +1,145 @@
+/* Checks and measures the batched environment (snake_env.h)
+ *  First the batch is stepped together with a copy of its games, which are
+ * played with plain snake_game_update() and restarted with snake_game_init(),
+ * and every observation is compared with the copy. Then steps are timed in
+ * one thread. Actions are random (precomputed, so they cost nothing), such
+ * snakes die often, so restarts are a part of the measurement. Some actions
+ * are out of snake_dir_t, the copy plays them as DIR_UNKNOWN.
+ *  usage: env_bench [-n batch] [-s steps] [-c check_steps] [-m file]
+ *   -n  games in the batch (default 1024)
+ *   -s  steps of the batch to time (default 20000)
+ *   -c  steps to check against snake_game_update() (default 2000)
+ *   -m  observations are in this file (snake_env_map()) instead of memory
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_SNAKE_LENGTH 64
+#define SNAKE_GAME_WIDTH 8
+#define SNAKE_GAME_HEIGHT 8
+#include "snake_game.h"
+#include "snake_env.h"
+
+#define NACTIONS 65536 // random actions, batch takes a window at a rolling offset
+
+static int8_t actions[NACTIONS];
+
+static long long now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static const int8_t *step_actions(unsigned int step, unsigned int n)
+	{ return &actions[(step * 7919u) % (NACTIONS - n)]; }
+
+static bool_t obs_equals_game(const snake_env_obs_t *o, const snake_game_t *game,
+	bool_t done, unsigned int final_score)
+{
+	snake_env_obs_t expected;
+	memset(expected.body, 0, sizeof expected.body);
+	for (unsigned int cell = 0; cell < SNAKE_NCELLS; ++cell)
+		if (game->map[cell] == CELL_SNAKE)
+			expected.body[cell / 64] |= 1ULL << (cell % 64);
+	return !memcmp(o->body, expected.body, sizeof o->body)
+		&& o->score == game->score
+		&& o->head == game->snake.segments[game->snake.head]
+		&& o->rabbit == game->rabbit
+		&& o->dir == game->snake.dir
+		&& o->done == done
+		&& (!done || o->final_score == final_score);
+}
+
+static bool_t check(snake_env_t *env, unsigned int nsteps)
+{
+	snake_game_t *ref = malloc(env->n * sizeof *ref);
+	memcpy(ref, env->games, env->n * sizeof *ref);
+	snake_env_reset(env);
+	for (unsigned int i = 0; i < env->n; ++i)
+		snake_game_init(&ref[i]);
+
+	for (unsigned int step = 0; step < nsteps; ++step) {
+		const int8_t *a = step_actions(step, env->n);
+		snake_env_step(env, a);
+		for (unsigned int i = 0; i < env->n; ++i) {
+			snake_game_update(&ref[i], (a[i] < DIR_UP || a[i] > DIR_DOWN) ? DIR_UNKNOWN : a[i]);
+			bool_t done = ref[i].is_finished;
+			unsigned int final_score = ref[i].score;
+			if (done)
+				snake_game_init(&ref[i]);
+			if (!obs_equals_game(&env->obs[i], &ref[i], done, final_score)) {
+				fprintf(stderr, "env_bench: game %u differs at step %u\n", i, step);
+				free(ref);
+				return false;
+			}
+		}
+	}
+	free(ref);
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int n = 1024, nsteps = 20000, ncheck = 2000;
+	const char *path = NULL;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:s:c:m:")) != -1) {
+		switch (opt) {
+		case 'n': n = atoi(optarg); break;
+		case 's': nsteps = atoi(optarg); break;
+		case 'c': ncheck = atoi(optarg); break;
+		case 'm': path = optarg; break;
+		default:
+			fprintf(stderr, "usage: %s [-n batch] [-s steps] [-c check_steps] [-m file]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (n == 0 || n > NACTIONS / 2) {
+		fprintf(stderr, "env_bench: batch must be 1..%d\n", NACTIONS / 2);
+		return EXIT_FAILURE;
+	}
+
+	uint16_t rng = 1;
+	static const int8_t dirs[] = { DIR_UNKNOWN, DIR_LEFT, DIR_RIGHT, DIR_UP, DIR_DOWN, 5, -128 };
+	for (unsigned int i = 0; i < NACTIONS; ++i)
+		actions[i] = dirs[snake_random(&rng) % ARR_SZ(dirs)];
+
+	snake_game_t *games = malloc(n * sizeof *games);
+	snake_env_obs_t *obs = path ? snake_env_map(path, n) : malloc(n * sizeof *obs);
+	if (!games || !obs) {
+		perror("env_bench");
+		return EXIT_FAILURE;
+	}
+	snake_env_t env;
+	snake_env_init(&env, games, obs, n, 1);
+
+	if (!check(&env, ncheck))
+		return EXIT_FAILURE;
+	printf("%u steps of %u games are the same as snake_game_update()\n", ncheck, n);
+
+	snake_env_reset(&env);
+	unsigned long long ndone = 0;
+	long long start = now_ns();
+	for (unsigned int step = 0; step < nsteps; ++step) {
+		snake_env_step(&env, step_actions(step, n));
+		for (unsigned int i = 0; i < n; ++i) // as an agent would read it
+			ndone += obs[i].done;
+	}
+	double seconds = (now_ns() - start) / 1e9;
+	double total = (double) nsteps * n;
+	printf("batch %u, obs %zu bytes: %.1f M steps/s per core, %.1f ns/step, %.1f%% of steps restart\n",
+		n, sizeof(snake_env_obs_t), total / seconds / 1e6, seconds * 1e9 / total, 100.0 * ndone / total);
+
+	if (path)
+		snake_env_unmap(obs, n);
+	else
+		free(obs);
+	free(games);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+/* Stand-in for the device on a pseudo-terminal
+ *  Runs the same game engine and speaks the same protocol (telemetry.h)
+ * as the firmware, so host tools may be tested without hardware.
+ * Path of the slave side of pty is printed to stdout, connect to it
+ * like to a serial port.
+ *  usage: fake_device [-x speedup] [-n ngames]
+ *   -x  divide game periods by this number (default 1)
+ *   -n  exit after this number of games (default - never)
+ */
+
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define MAX_SNAKE_LENGTH 64
+#define SNAKE_GAME_WIDTH 8
+#define SNAKE_GAME_HEIGHT 8
+#include "snake_game.h"
+#include "host_uart.h"
+#include "telemetry.h"
+#include "levels.h"
+#include "host_game.h"
+
+static host_game_t session;
+static int speedup = 1;
+
+static int open_pty()
+{
+	int fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+		perror("fake_device: pty");
+		exit(EXIT_FAILURE);
+	}
+	struct termios tio;
+	tcgetattr(fd, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(fd, TCSANOW, &tio);
+	return fd;
+}
+
+int main(int argc, char *argv[])
+{
+	int ngames = -1;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "x:n:")) != -1) {
+		switch (opt) {
+		case 'x': speedup = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+		case 'n': ngames = atoi(optarg); break;
+		default:
+			fprintf(stderr, "usage: %s [-x speedup] [-n ngames]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	int fd = open_pty();
+	host_uart_init(fd);
+	printf("%s\n", ptsname(fd));
+	fflush(stdout);
+
+	telemetry_parser_t parser;
+	telemetry_parser_init(&parser);
+	host_game_init(&session);
+	host_game_start(&session, host_now_us());
+
+	long long prev_tick = host_now_us();
+	long long next_tick = prev_tick + host_game_period_us(&session, speedup);
+	long long restart_at = 0;
+
+	while (ngames != 0) {
+		host_uart_flush();
+
+		long long now = host_now_us();
+		long long deadline = restart_at ? restart_at : next_tick;
+		struct pollfd pfd = { .fd = fd, .events = POLLIN };
+		int timeout_ms = deadline > now ? (deadline - now + 999) / 1000 : 0;
+
+		if (poll(&pfd, 1, timeout_ms) > 0 && (pfd.revents & POLLIN)) {
+			byte_t buf[256];
+			ssize_t n = read(fd, buf, sizeof buf);
+			for (ssize_t i = 0; i < n; ++i)
+				if (telemetry_parse_byte(&parser, buf[i]))
+					host_game_handle_command(&session, &parser);
+		}
+
+		now = host_now_us();
+		if (restart_at) {
+			if (now >= restart_at) {
+				restart_at = 0;
+				host_game_start(&session, now);
+				prev_tick = now;
+				next_tick = now + host_game_period_us(&session, speedup);
+			}
+		} else if (now >= next_tick) {
+			if (!session.is_paused)
+				host_game_update(&session, now - prev_tick);
+			prev_tick = now;
+			next_tick = now + host_game_period_us(&session, speedup);
+			if (session.game.is_finished) {
+				restart_at = now + HOST_GAME_RESTART_MS * 1000LL / speedup;
+				if (ngames > 0)
+					--ngames;
+			}
+		}
+	}
+	host_uart_flush();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,343 @@
+/* Append-only corpus of recorded games with a memory-mapped index
+ *  The engine is deterministic, so a game is its start (seed, spawn mode,
+ * level) and the direction of every tick, 2 bits each. A corpus is two files:
+ *  PATH.idx   -- header corpus_file_header_t, then one corpus_entry_t of 32
+ *                bytes per game: summary for queries and offset of its moves
+ *  PATH.moves -- packed moves of all games one after another, tick t is in
+ *                bits 2 * (t & 3) of byte t >> 2 (index of direction in
+ *                up, left, right, down order)
+ * Games are only appended (moves first, so the index never points past the
+ * data), there must be one writer at a time. Readers mmap both files, so
+ * scans are over the index in place, corpus_query() splits it across threads,
+ * corpus_replay() runs any game through snake_game_update() again.
+ *  Recording: corpus_game_start() instead of snake_game_init() and
+ * corpus_game_update() instead of snake_game_update() fill corpus_journal_t,
+ * finished games are added with corpus_append().
+ *  snake_game.h and levels.h must be included before this file.
+ */
+
+#ifndef GAME_CORPUS_H_
+#define GAME_CORPUS_H_
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "decls.h"
+
+#define CORPUS_MAGIC 0x43474E53 // "SNGC"
+#define CORPUS_VERSION 1
+#define CORPUS_MAX_THREADS 64
+
+typedef enum {
+	CORPUS_ALIVE, // recorded before game over
+	CORPUS_DEATH_SELF, // ran into itself
+	CORPUS_DEATH_WALL, // ran into a wall of the level
+	CORPUS_DEATH_BORDER // went out of the board with SNAKE_GAME_NO_WRAP
+} corpus_death_t;
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t entry_size;
+	uint8_t width, height;
+	uint8_t reserved[6];
+} corpus_file_header_t;
+
+typedef struct {
+	uint64_t moves; // offset in PATH.moves
+	uint32_t length; // ticks
+	uint32_t last_wrap; // tick of the last wrap-around + 1, 0 if never wrapped
+	uint16_t score;
+	uint16_t seed; // before snake_game_init()
+	uint16_t nwraps; // moves across borders
+	uint8_t death; // corpus_death_t
+	uint8_t level;
+	uint8_t spawn_mode;
+	uint8_t reserved[7];
+} corpus_entry_t;
+
+typedef struct {
+	corpus_entry_t entry;
+	byte_t *moves;
+	size_t capacity; // of moves in bytes
+} corpus_journal_t;
+
+typedef struct {
+	int idx_fd, moves_fd;
+	uint64_t moves_size;
+} corpus_writer_t;
+
+typedef struct {
+	const corpus_entry_t *index;
+	size_t ngames;
+	const byte_t *moves;
+	size_t moves_size;
+	void *_idx_map;
+	size_t _idx_size;
+} corpus_t;
+
+static int _corpus_open_file(const char *path, const char *ext, int flags)
+{
+	char name[4096];
+	snprintf(name, sizeof name, "%s%s", path, ext);
+	return open(name, flags | O_CLOEXEC, 0644);
+}
+
+/* journal is reused for the next games, free it with corpus_journal_free() */
+void corpus_journal_init(corpus_journal_t *j)
+{
+	memset(&j->entry, 0, sizeof j->entry);
+	j->moves = NULL;
+	j->capacity = 0;
+}
+
+void corpus_journal_free(corpus_journal_t *j)
+{
+	free(j->moves);
+	corpus_journal_init(j);
+}
+
+/* loads level and starts the game, seed and spawn_mode of game are used */
+void corpus_game_start(corpus_journal_t *j, snake_game_t *game, byte_t level)
+{
+	if (level >= NLEVELS)
+		level = 0;
+	level_load(game, level);
+	memset(&j->entry, 0, sizeof j->entry);
+	j->entry.seed = game->seed;
+	j->entry.level = level;
+	j->entry.spawn_mode = game->spawn_mode;
+	snake_game_init(game);
+	j->entry.score = game->score;
+}
+
+static int _corpus_distance(int a, int b)
+	{ return a > b ? a - b : b - a; }
+
+/* returns false, if there is no memory for the move, the game isn't updated then */
+bool_t corpus_game_update(corpus_journal_t *j, snake_game_t *game, snake_dir_t next_dir)
+{
+	if (game->is_finished)
+		return true;
+	corpus_entry_t *e = &j->entry;
+	if (e->length / 4 >= j->capacity) {
+		size_t capacity = j->capacity ? j->capacity * 2 : 64;
+		byte_t *moves = realloc(j->moves, capacity);
+		if (!moves)
+			return false;
+		j->moves = moves;
+		j->capacity = capacity;
+	}
+
+	cell_idx_t head = game->snake.segments[game->snake.head];
+	snake_game_update(game, next_dir);
+	byte_t shift = 2 * (e->length & 3);
+	byte_t *move = &j->moves[e->length / 4];
+	*move = (shift ? *move : 0) | _SNAKE_DIR_IDX(game->snake.dir) << shift;
+	++e->length;
+	e->score = game->score;
+
+	if (game->is_finished) {
+		cell_idx_t next = snake_next_head_pos(&game->snake); // snake stays before the cell
+		e->death = next == SNAKE_CELL_NONE ? CORPUS_DEATH_BORDER
+			: WALL_ELEM(game->walls, next) ? CORPUS_DEATH_WALL : CORPUS_DEATH_SELF;
+	} else {
+		cell_idx_t new_head = game->snake.segments[game->snake.head];
+		if (_corpus_distance(SNAKE_CELL_X(head), SNAKE_CELL_X(new_head)) > 1
+			|| _corpus_distance(SNAKE_CELL_Y(head), SNAKE_CELL_Y(new_head)) > 1) {
+			++e->nwraps;
+			e->last_wrap = e->length;
+		}
+	}
+	return true;
+}
+
+/* creates files, if there are none, returns false on failure */
+bool_t corpus_writer_open(corpus_writer_t *w, const char *path)
+{
+	struct stat st;
+	w->idx_fd = _corpus_open_file(path, ".idx", O_WRONLY | O_CREAT | O_APPEND);
+	w->moves_fd = _corpus_open_file(path, ".moves", O_WRONLY | O_CREAT | O_APPEND);
+	if (w->idx_fd < 0 || w->moves_fd < 0 || fstat(w->idx_fd, &st) < 0)
+		goto fail;
+	if (st.st_size == 0) {
+		corpus_file_header_t h = {
+			.magic = CORPUS_MAGIC, .version = CORPUS_VERSION, .entry_size = sizeof(corpus_entry_t),
+			.width = SNAKE_GAME_WIDTH, .height = SNAKE_GAME_HEIGHT
+		};
+		if (write(w->idx_fd, &h, sizeof h) != sizeof h)
+			goto fail;
+	}
+	if (fstat(w->moves_fd, &st) < 0)
+		goto fail;
+	w->moves_size = st.st_size;
+	return true;
+
+fail:
+	if (w->idx_fd >= 0)
+		close(w->idx_fd);
+	if (w->moves_fd >= 0)
+		close(w->moves_fd);
+	return false;
+}
+
+void corpus_writer_close(corpus_writer_t *w)
+{
+	close(w->idx_fd);
+	close(w->moves_fd);
+}
+
+bool_t corpus_append(corpus_writer_t *w, const corpus_journal_t *j)
+{
+	size_t nbytes = (j->entry.length + 3) / 4;
+	corpus_entry_t e = j->entry;
+	e.moves = w->moves_size;
+	if (write(w->moves_fd, j->moves, nbytes) != (ssize_t) nbytes)
+		return false;
+	w->moves_size += nbytes;
+	return write(w->idx_fd, &e, sizeof e) == sizeof e;
+}
+
+/*  Maps the corpus read-only, games appended later are not seen. Returns
+ * false, if files are missing or made for another board */
+bool_t corpus_open(corpus_t *c, const char *path)
+{
+	struct stat st;
+	memset(c, 0, sizeof *c);
+	c->_idx_map = MAP_FAILED;
+	c->moves = MAP_FAILED;
+	int idx_fd = _corpus_open_file(path, ".idx", O_RDONLY);
+	int moves_fd = _corpus_open_file(path, ".moves", O_RDONLY);
+	bool_t ok = false;
+	if (idx_fd < 0 || moves_fd < 0 || fstat(idx_fd, &st) < 0 || st.st_size < (off_t) sizeof(corpus_file_header_t))
+		goto done;
+	c->_idx_size = st.st_size;
+	c->_idx_map = mmap(NULL, c->_idx_size, PROT_READ, MAP_SHARED, idx_fd, 0);
+	if (c->_idx_map == MAP_FAILED || fstat(moves_fd, &st) < 0)
+		goto done;
+	const corpus_file_header_t *h = c->_idx_map;
+	if (h->magic != CORPUS_MAGIC || h->version != CORPUS_VERSION || h->entry_size != sizeof(corpus_entry_t)
+		|| h->width != SNAKE_GAME_WIDTH || h->height != SNAKE_GAME_HEIGHT)
+		goto done;
+	c->moves_size = st.st_size;
+	if (c->moves_size) {
+		c->moves = mmap(NULL, c->moves_size, PROT_READ, MAP_SHARED, moves_fd, 0);
+		if (c->moves == MAP_FAILED)
+			goto done;
+	} else {
+		c->moves = NULL;
+	}
+	c->index = (const corpus_entry_t *) (h + 1);
+	c->ngames = (c->_idx_size - sizeof *h) / sizeof(corpus_entry_t); // the last one may be being written
+	ok = true;
+done:
+	if (idx_fd >= 0)
+		close(idx_fd);
+	if (moves_fd >= 0)
+		close(moves_fd);
+	if (!ok) {
+		if (c->_idx_map != MAP_FAILED)
+			munmap(c->_idx_map, c->_idx_size);
+		c->_idx_map = NULL;
+		c->moves = NULL;
+	}
+	return ok;
+}
+
+void corpus_close(corpus_t *c)
+{
+	if (c->_idx_map)
+		munmap(c->_idx_map, c->_idx_size);
+	if (c->moves)
+		munmap((void *) c->moves, c->moves_size);
+	memset(c, 0, sizeof *c);
+}
+
+typedef bool_t (*corpus_predicate_t)(const corpus_entry_t *e, const void *arg);
+
+typedef struct {
+	const corpus_t *corpus;
+	corpus_predicate_t pred;
+	const void *arg;
+	uint32_t *out;
+	size_t start, end, nfound;
+} _corpus_query_part_t;
+
+static void *_corpus_query_part(void *arg)
+{
+	_corpus_query_part_t *p = arg;
+	uint32_t *out = p->out + p->start;
+	size_t nfound = 0;
+	for (size_t i = p->start; i < p->end; ++i)
+		if (p->pred(&p->corpus->index[i], p->arg))
+			out[nfound++] = i;
+	p->nfound = nfound;
+	return NULL;
+}
+
+/*  Numbers of games, for which pred is true, go to out in order, out must
+ * have room for all games. Index is split between nthreads threads (up to
+ * CORPUS_MAX_THREADS). Returns number of games found */
+size_t corpus_query(const corpus_t *c, corpus_predicate_t pred, const void *arg, uint32_t *out, int nthreads)
+{
+	_corpus_query_part_t parts[CORPUS_MAX_THREADS];
+	pthread_t threads[CORPUS_MAX_THREADS];
+	bool_t is_started[CORPUS_MAX_THREADS];
+	if (nthreads < 1)
+		nthreads = 1;
+	if (nthreads > CORPUS_MAX_THREADS)
+		nthreads = CORPUS_MAX_THREADS;
+
+	for (int t = 0; t < nthreads; ++t) {
+		parts[t] = (_corpus_query_part_t) {
+			.corpus = c, .pred = pred, .arg = arg, .out = out,
+			.start = c->ngames * t / nthreads, .end = c->ngames * (t + 1) / nthreads
+		};
+		/* the first part and parts, for which there is no thread, are done here */
+		is_started[t] = t > 0 && pthread_create(&threads[t], NULL, _corpus_query_part, &parts[t]) == 0;
+	}
+	for (int t = 0; t < nthreads; ++t) {
+		if (is_started[t])
+			pthread_join(threads[t], NULL);
+		else
+			_corpus_query_part(&parts[t]);
+	}
+
+	size_t nfound = parts[0].nfound; // parts are packed to the front in order
+	for (int t = 1; t < nthreads; ++t) {
+		memmove(out + nfound, out + parts[t].start, parts[t].nfound * sizeof *out);
+		nfound += parts[t].nfound;
+	}
+	return nfound;
+}
+
+typedef void (*corpus_replay_callback_t)(const snake_game_t *game, uint32_t tick, void *arg);
+
+/*  Plays game number i again, callback (may be NULL) is called after every
+ * tick. Returns false, if the result differs from the index (corrupted
+ * corpus or another engine) */
+bool_t corpus_replay(const corpus_t *c, size_t i, snake_game_t *game, corpus_replay_callback_t callback, void *arg)
+{
+	const corpus_entry_t *e = &c->index[i];
+	if (e->moves + (e->length + 3) / 4 > c->moves_size)
+		return false;
+	const byte_t *moves = c->moves + e->moves;
+
+	game->seed = e->seed;
+	game->spawn_mode = e->spawn_mode;
+	level_load(game, e->level);
+	snake_game_init(game);
+	for (uint32_t t = 0; t < e->length && !game->is_finished; ++t) {
+		byte_t dir_idx = moves[t / 4] >> (2 * (t & 3)) & 3;
+		snake_game_update(game, (int8_t) pgm_read_byte(&_snake_dirs[dir_idx]));
+		if (callback)
+			callback(game, t, arg);
+	}
+	return game->score == e->score && game->is_finished == (e->death != CORPUS_ALIVE);
+}
+
+#endif // GAME_CORPUS_H_
@@ -0,0 +1,382 @@
+/* Game server: many sessions of the device game over sockets
+ *  Every connection is a session with its own game, which behaves like
+ * fake_device (host_game.h: the same engine, periods of snake_score_to_speed()
+ * and telemetry.h protocol), so bots (server_load plays like snake_client.py)
+ * play against the device rules. Listens on a unix socket and/or TCP on loopback.
+ *  One thread: epoll for sockets, a timer wheel with 1 ms slots for ticks
+ * and restarts of all sessions, sessions are allocated from a slab pool.
+ * Output of a session is buffered (like uart tx buffer: frames, which don't
+ * fit, are dropped and counted) and written after each event, the rest waits
+ * for EPOLLOUT.
+ *  usage: game_server [-u path] [-t port] [-x speedup] [-s seconds]
+ *   -u  unix socket path
+ *   -t  TCP port on 127.0.0.1
+ *   -x  divide game periods by this number (default 1)
+ *   -s  print statistics to stderr every this number of seconds
+ *  Statistics: sessions, ticks per second, lateness of ticks against the timer
+ * (p50, p99, max), cpu time per session and the best score since start.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define MAX_SNAKE_LENGTH 64
+#define SNAKE_GAME_WIDTH 8
+#define SNAKE_GAME_HEIGHT 8
+#include "snake_game.h"
+
+/* uart of telemetry.h writes to the session being served */
+#define SESSION_OUT_SIZE 512
+
+typedef struct session session_t;
+static session_t *current;
+unsigned int uart_tx_free();
+bool_t uart_putc(byte_t byte);
+
+#include "telemetry.h"
+#include "levels.h"
+#include "host_game.h"
+#include "timer_wheel.h"
+#include "slab_pool.h"
+
+#define MAX_EVENTS 256
+#define LATENESS_BUCKETS 1000 // of 0.1 ms, the last one is for everything later
+
+struct session {
+	timer_wheel_entry_t timer; // tick or restart
+	int fd;
+	bool_t is_restarting; // timer is for restart
+	bool_t is_blocked; // socket didn't take all output, waiting for EPOLLOUT
+	long long prev_tick_us;
+	telemetry_parser_t parser;
+	host_game_t game;
+	unsigned int out_len;
+	byte_t out[SESSION_OUT_SIZE];
+};
+
+typedef struct {
+	long long ticks;
+	uint32_t lateness[LATENESS_BUCKETS];
+	long long max_lateness_us;
+} server_stats_t;
+
+static int epfd;
+static int speedup = 1;
+static timer_wheel_t wheel;
+static slab_pool_t pool;
+static server_stats_t stats;
+static unsigned int best_score;
+static int listeners[2] = { -1, -1 };
+
+unsigned int uart_tx_free()
+	{ return SESSION_OUT_SIZE - current->out_len; }
+
+bool_t uart_putc(byte_t byte)
+{
+	if (current->out_len == SESSION_OUT_SIZE)
+		return false;
+	current->out[current->out_len++] = byte;
+	return true;
+}
+
+static uint64_t now_ms() { return host_now_us() / 1000; }
+
+static void close_session(session_t *s)
+{
+	timer_wheel_cancel(&wheel, &s->timer);
+	epoll_ctl(epfd, EPOLL_CTL_DEL, s->fd, NULL);
+	close(s->fd);
+	slab_pool_free(&pool, s);
+}
+
+/*  Writes buffered output, what the socket doesn't take waits for EPOLLOUT.
+ * Returns false if session was closed */
+static bool_t flush_session(session_t *s)
+{
+	unsigned int sent = 0;
+	while (sent < s->out_len) {
+		ssize_t n = send(s->fd, s->out + sent, s->out_len - sent, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && errno == EAGAIN)
+			break;
+		if (n <= 0) {
+			close_session(s);
+			return false;
+		}
+		sent += n;
+	}
+	s->out_len -= sent;
+	memmove(s->out, s->out + sent, s->out_len);
+
+	bool_t wants_out = s->out_len != 0;
+	if (wants_out != s->is_blocked) {
+		struct epoll_event ev = { .events = wants_out ? EPOLLIN | EPOLLOUT : EPOLLIN, .data.ptr = s };
+		epoll_ctl(epfd, EPOLL_CTL_MOD, s->fd, &ev);
+		s->is_blocked = wants_out;
+	}
+	return true;
+}
+
+/* slots are whole milliseconds, due time is rounded up, so ticks are never early */
+static uint64_t due_ms(long long due_us) { return (due_us + 999) / 1000; }
+
+static void schedule_tick(session_t *s, long long now_us)
+{
+	s->is_restarting = false;
+	s->prev_tick_us = now_us;
+	timer_wheel_add(&wheel, &s->timer, due_ms(now_us + host_game_period_us(&s->game, speedup)));
+}
+
+static void on_timer(timer_wheel_entry_t *entry)
+{
+	session_t *s = TIMER_WHEEL_OWNER(entry, session_t, timer);
+	long long now = host_now_us();
+	long long late = now - (long long) entry->due * 1000;
+	if (late < 0)
+		late = 0;
+	if (late > stats.max_lateness_us)
+		stats.max_lateness_us = late;
+	++stats.lateness[late / 100 < LATENESS_BUCKETS ? late / 100 : LATENESS_BUCKETS - 1];
+
+	current = s;
+	if (s->is_restarting) {
+		host_game_start(&s->game, now);
+		schedule_tick(s, now);
+	} else {
+		if (!s->game.is_paused) {
+			host_game_update(&s->game, now - s->prev_tick_us);
+			++stats.ticks;
+		}
+		if (s->game.game.is_finished) {
+			if (s->game.game.score > best_score)
+				best_score = s->game.game.score;
+			s->is_restarting = true;
+			timer_wheel_add(&wheel, &s->timer, due_ms(now + HOST_GAME_RESTART_MS * 1000LL / speedup));
+		} else
+			schedule_tick(s, now);
+	}
+	flush_session(s);
+}
+
+static void accept_sessions(int listener)
+{
+	for (;;) {
+		int fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0) {
+			if (errno != EAGAIN && errno != EINTR && errno != ECONNABORTED)
+				perror("game_server: accept");
+			return;
+		}
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one); // fails harmlessly on unix sockets
+
+		session_t *s = slab_pool_alloc(&pool);
+		if (!s) {
+			close(fd);
+			continue;
+		}
+		s->fd = fd;
+		s->out_len = 0;
+		s->is_blocked = false;
+		telemetry_parser_init(&s->parser);
+		timer_wheel_entry_init(&s->timer);
+		host_game_init(&s->game);
+		s->game.game.seed = fd;
+
+		struct epoll_event ev = { .events = EPOLLIN, .data.ptr = s };
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+			close(fd);
+			slab_pool_free(&pool, s);
+			continue;
+		}
+		long long now = host_now_us();
+		current = s;
+		host_game_start(&s->game, now);
+		schedule_tick(s, now);
+		flush_session(s);
+	}
+}
+
+static void read_session(session_t *s)
+{
+	byte_t buf[1024];
+	for (;;) {
+		ssize_t n = recv(s->fd, buf, sizeof buf, 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && errno == EAGAIN)
+			break;
+		if (n <= 0) {
+			close_session(s);
+			return;
+		}
+		current = s;
+		for (ssize_t i = 0; i < n; ++i)
+			if (telemetry_parse_byte(&s->parser, buf[i]))
+				host_game_handle_command(&s->game, &s->parser);
+	}
+	flush_session(s);
+}
+
+static int listen_unix(const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	if (strlen(path) >= sizeof addr.sun_path) {
+		fprintf(stderr, "game_server: socket path is too long\n");
+		exit(EXIT_FAILURE);
+	}
+	strcpy(addr.sun_path, path);
+	unlink(path);
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0 || bind(fd, (struct sockaddr *) &addr, sizeof addr) < 0 || listen(fd, SOMAXCONN) < 0) {
+		perror("game_server: unix socket");
+		exit(EXIT_FAILURE);
+	}
+	return fd;
+}
+
+static int listen_tcp(int port)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+	};
+	int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	int one = 1;
+	if (fd >= 0)
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+	if (fd < 0 || bind(fd, (struct sockaddr *) &addr, sizeof addr) < 0 || listen(fd, SOMAXCONN) < 0) {
+		perror("game_server: tcp socket");
+		exit(EXIT_FAILURE);
+	}
+	return fd;
+}
+
+/* thousands of sessions need more descriptors than the default soft limit */
+static void raise_fd_limit()
+{
+	struct rlimit lim;
+	if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+		lim.rlim_cur = lim.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &lim);
+	}
+}
+
+static long long cpu_us()
+{
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000LL + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+/* in microseconds, upper bound of the bucket */
+static long long lateness_percentile(const server_stats_t *st, double fraction)
+{
+	long long total = 0, seen = 0;
+	for (int i = 0; i < LATENESS_BUCKETS; ++i)
+		total += st->lateness[i];
+	for (int i = 0; i < LATENESS_BUCKETS; ++i) {
+		seen += st->lateness[i];
+		if (seen && seen >= total * fraction)
+			return (i + 1) * 100LL;
+	}
+	return 0;
+}
+
+static void print_stats(double seconds, long long cpu)
+{
+	size_t nsessions = pool.nused;
+	fprintf(stderr, "sessions %zu, ticks/s %.0f, late p50 %.1f ms p99 %.1f ms max %.1f ms, "
+		"cpu %.1f%% (%.1f us/s per session), best score %u\n",
+		nsessions, stats.ticks / seconds,
+		lateness_percentile(&stats, 0.5) / 1000.0, lateness_percentile(&stats, 0.99) / 1000.0,
+		stats.max_lateness_us / 1000.0, 100.0 * cpu / (seconds * 1e6),
+		nsessions ? cpu / seconds / nsessions : 0.0, best_score);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *unix_path = NULL;
+	int port = 0, stats_period_s = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "u:t:x:s:")) != -1) {
+		switch (opt) {
+		case 'u': unix_path = optarg; break;
+		case 't': port = atoi(optarg); break;
+		case 'x': speedup = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+		case 's': stats_period_s = atoi(optarg); break;
+		default:
+			goto usage;
+		}
+	}
+	if (!unix_path && !port)
+		goto usage;
+
+	signal(SIGPIPE, SIG_IGN);
+	raise_fd_limit();
+	slab_pool_init(&pool, sizeof(session_t));
+	timer_wheel_init(&wheel, now_ms());
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (unix_path)
+		listeners[0] = listen_unix(unix_path);
+	if (port)
+		listeners[1] = listen_tcp(port);
+	for (int i = 0; i < 2; ++i)
+		if (listeners[i] >= 0) {
+			/* listeners are told from sessions by pointers into this array */
+			struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &listeners[i] };
+			epoll_ctl(epfd, EPOLL_CTL_ADD, listeners[i], &ev);
+		}
+
+	long long stats_start = host_now_us(), stats_cpu = cpu_us();
+	for (;;) {
+		uint64_t now = now_ms();
+		uint64_t due = timer_wheel_next_due(&wheel);
+		long long timeout = due == TIMER_WHEEL_NEVER ? 1000 : due > now ? (long long) (due - now) : 0;
+		if (stats_period_s && timeout > 1000)
+			timeout = 1000;
+
+		struct epoll_event events[MAX_EVENTS];
+		int n = epoll_wait(epfd, events, MAX_EVENTS, timeout);
+		for (int i = 0; i < n; ++i) {
+			void *ptr = events[i].data.ptr;
+			if (ptr == &listeners[0] || ptr == &listeners[1])
+				accept_sessions(*(int *) ptr);
+			else if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+				read_session(ptr);
+			else if (events[i].events & EPOLLOUT)
+				flush_session(ptr);
+		}
+		/* sessions are closed in their own events or timers only, so events
+		 * of this batch don't point to freed ones */
+		timer_wheel_advance(&wheel, now_ms(), on_timer);
+
+		long long t = host_now_us();
+		if (stats_period_s && t - stats_start >= stats_period_s * 1000000LL) {
+			long long cpu = cpu_us();
+			print_stats((t - stats_start) / 1e6, cpu - stats_cpu);
+			memset(&stats, 0, sizeof stats);
+			stats_start = t;
+			stats_cpu = cpu;
+		}
+	}
+
+usage:
+	fprintf(stderr, "usage: %s [-u path] [-t port] [-x speedup] [-s seconds]\n", argv[0]);
+	return EXIT_FAILURE;
+}
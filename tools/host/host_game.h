@@ -0,0 +1,134 @@
+/* One game, as the firmware runs it, for host programs
+ *  The engine plus the state, which main.c keeps around it (direction from
+ * joystick, pause, settings), and handling of telemetry.h commands. Frames
+ * are sent with telemetry_send(), i.e. through uart_putc() of the includer.
+ * Used by fake_device (one game on a pty) and game_server (many sessions).
+ *  snake_game.h, telemetry.h and levels.h must be included before this file.
+ */
+
+#ifndef HOST_GAME_H_
+#define HOST_GAME_H_
+
+#include <time.h>
+#include "decls.h"
+
+/* the same values as in button.h */
+enum { BUTTON_PRESSED, BUTTON_RELEASED, BUTTON_LONG_PRESSED };
+
+#define HOST_GAME_RESTART_MS 1000 // pause after game over
+
+typedef struct {
+	snake_game_t game;
+	snake_dir_t dir;
+	bool_t is_paused;
+	bool_t pause_on_release;
+	byte_t speed_curve;
+	uint16_t ticks;
+} host_game_t;
+
+long long host_now_us()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+void host_game_init(host_game_t *g)
+{
+	g->game.seed = 1;
+	g->game.spawn_mode = SPAWN_SPACIOUS;
+	level_load(&g->game, 0);
+	g->game.is_finished = true;
+	g->speed_curve = SPEED_CURVE_NORMAL;
+	g->ticks = 0;
+}
+
+/* seed is mixed with entropy, so games differ */
+void host_game_start(host_game_t *g, uint16_t entropy)
+{
+	g->dir = DIR_UNKNOWN;
+	g->is_paused = g->pause_on_release = false;
+	g->game.seed ^= entropy;
+	snake_game_init(&g->game);
+	telemetry_send_event(TM_EV_GAME_START, SNAKE_CELL_X(g->game.rabbit), SNAKE_CELL_Y(g->game.rabbit));
+}
+
+/* period before the next tick, game periods are divided by speedup */
+long long host_game_period_us(const host_game_t *g, int speedup)
+	{ return snake_score_to_speed(g->game.score, g->speed_curve) * 1000LL / speedup; }
+
+/* period_us - time since the previous tick, sent in TM_MSG_TICK */
+void host_game_update(host_game_t *g, long long period_us)
+{
+	long long start = host_now_us();
+	unsigned int prev_score = g->game.score;
+
+	snake_game_update(&g->game, g->dir);
+	if (g->game.score != prev_score)
+		telemetry_send_event(TM_EV_RABBIT, SNAKE_CELL_X(g->game.rabbit), SNAKE_CELL_Y(g->game.rabbit));
+
+	/* units are the same as on device at 1MHz: 2 ms and 8 us */
+	uint16_t period = period_us / 2000;
+	uint16_t duration = (host_now_us() - start) / 8;
+	cell_idx_t head = g->game.snake.segments[g->game.snake.head];
+	byte_t payload[] = {
+		g->ticks, g->ticks >> 8,
+		period, period >> 8,
+		duration, duration >> 8,
+		g->game.score,
+		SNAKE_CELL_X(head) << 4 | SNAKE_CELL_Y(head),
+		g->game.snake.dir
+	};
+	telemetry_send(TM_MSG_TICK, payload, sizeof payload);
+	++g->ticks;
+
+	if (g->game.is_finished)
+		telemetry_send_event(TM_EV_GAME_OVER, g->game.score, g->game.score >> 8);
+}
+
+void host_game_handle_command(host_game_t *g, const telemetry_parser_t *cmd)
+{
+	switch (cmd->type) {
+	case TM_CMD_DIR: {
+		snake_dir_t dir = (int8_t) cmd->payload[0];
+		if (cmd->len == 1 && (dir == DIR_LEFT || dir == DIR_RIGHT || dir == DIR_UP || dir == DIR_DOWN)) {
+			g->dir = dir;
+			telemetry_send_event(TM_EV_DIR, dir, 0);
+		}
+		break;
+	}
+	case TM_CMD_BUTTON:
+		/* as main.c: pause on release of a short press */
+		if (cmd->len != 1 || g->game.is_finished)
+			break;
+		if (cmd->payload[0] != BUTTON_RELEASED) {
+			g->pause_on_release = cmd->payload[0] == BUTTON_PRESSED;
+		} else if (g->pause_on_release) {
+			g->pause_on_release = false;
+			g->is_paused = !g->is_paused;
+			telemetry_send_event(g->is_paused ? TM_EV_PAUSE : TM_EV_RESUME, 0, 0);
+		}
+		break;
+	case TM_CMD_GET_COUNTERS: {
+		/* there is no power management on host, duty is always 100% */
+		uint16_t counters[] = { 1000, 0, g->ticks, 0, 0, telemetry_dropped() };
+		byte_t payload[2 * ARR_SZ(counters)];
+		for (unsigned int i = 0; i < ARR_SZ(counters); ++i) {
+			payload[2 * i] = counters[i];
+			payload[2 * i + 1] = counters[i] >> 8;
+		}
+		telemetry_send(TM_MSG_COUNTERS, payload, sizeof payload);
+		break;
+	}
+	case TM_CMD_SET_SETTINGS:
+		if (cmd->len == 3 || cmd->len == 4) {
+			g->speed_curve = cmd->payload[1];
+			g->game.spawn_mode = cmd->payload[2];
+			if (cmd->len == 4)
+				level_load(&g->game, cmd->payload[3]); // from the next game
+		}
+		break;
+	}
+}
+
+#endif // HOST_GAME_H_
@@ -0,0 +1,42 @@
+/* Host replacement for uart.h: bytes go to a file descriptor
+ * (e.g. master side of a pseudo-terminal). Output is buffered until
+ * host_uart_flush() */
+
+#ifndef HOST_UART_H_
+#define HOST_UART_H_
+
+#include <unistd.h>
+#include "decls.h"
+
+#define HOST_UART_BUFFER_SIZE 4096
+
+static int _host_uart_fd = -1;
+static byte_t _host_uart_buffer[HOST_UART_BUFFER_SIZE];
+static unsigned int _host_uart_len;
+
+void host_uart_init(int fd) { _host_uart_fd = fd; }
+
+unsigned int uart_tx_free()
+	{ return HOST_UART_BUFFER_SIZE - _host_uart_len; }
+
+bool_t uart_putc(byte_t byte)
+{
+	if (_host_uart_len == HOST_UART_BUFFER_SIZE)
+		return false;
+	_host_uart_buffer[_host_uart_len++] = byte;
+	return true;
+}
+
+void host_uart_flush()
+{
+	unsigned int pos = 0;
+	while (pos < _host_uart_len) {
+		ssize_t n = write(_host_uart_fd, _host_uart_buffer + pos, _host_uart_len - pos);
+		if (n <= 0)
+			break; // nobody listens, drop the rest like a real uart would
+		pos += n;
+	}
+	_host_uart_len = 0;
+}
+
+#endif // HOST_UART_H_
@@ -0,0 +1,320 @@
+/* Load generator for game_server
+ *  Opens many sessions, every one is played by the bot of snake_client.py
+ * (goes to the rabbit by the shortest way on the torus), and measures
+ * lateness of ticks: a tick should come snake_score_to_speed() after the
+ * previous one (game_server counts periods from the actual tick time, like
+ * the device), so arrival later than that is scheduling and transport delay.
+ * Prints every second and at the end: sessions, ticks per second, lateness
+ * p50, p99 and max, and with -p cpu time of the server per session.
+ *  usage: server_load (-u path | -t port) [-n sessions] [-d seconds] [-x speedup] [-p server_pid]
+ *   -n  number of sessions (default 1000)
+ *   -d  duration of measurement (default 10)
+ *   -x  must be the same as game_server -x (default 1)
+ *   -p  pid of game_server, its cpu time is read from /proc
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "decls.h"
+#include "snake_common.h"
+
+#define BOARD_SIZE 8 // of game_server
+#define MAX_EVENTS 256
+#define LATENESS_BUCKETS 1000 // of 0.1 ms, the last one is for everything later
+
+/* commands are sent right away from a small buffer */
+static byte_t out[64];
+static unsigned int out_len;
+unsigned int uart_tx_free() { return sizeof out - out_len; }
+bool_t uart_putc(byte_t byte) { out[out_len++] = byte; return true; }
+
+#include "telemetry.h"
+
+typedef struct {
+	int fd;
+	telemetry_parser_t parser;
+	bool_t is_playing;
+	byte_t rabbit_x, rabbit_y;
+	snake_dir_t sent_dir;
+	long long last_us; // arrival of the last tick or of game start
+	long long expected_us; // period after it
+} client_t;
+
+typedef struct {
+	long long ticks, games;
+	uint32_t lateness[LATENESS_BUCKETS];
+	long long max_lateness_us;
+} load_stats_t;
+
+static int speedup = 1;
+static load_stats_t stats;
+static int nopen;
+
+static long long now_us()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static int wrap_delta(int src, int dst)
+{
+	int delta = ((dst - src) % BOARD_SIZE + BOARD_SIZE) % BOARD_SIZE;
+	return delta > BOARD_SIZE / 2 ? delta - BOARD_SIZE : delta;
+}
+
+/* as choose_dir() of snake_client.py */
+static snake_dir_t choose_dir(const client_t *c, int head_x, int head_y, snake_dir_t current)
+{
+	int dx = wrap_delta(head_x, c->rabbit_x), dy = wrap_delta(head_y, c->rabbit_y);
+	if (dx && (dx > 0 ? DIR_RIGHT : DIR_LEFT) != -current)
+		return dx > 0 ? DIR_RIGHT : DIR_LEFT;
+	if (dy && (dy > 0 ? DIR_DOWN : DIR_UP) != -current)
+		return dy > 0 ? DIR_DOWN : DIR_UP;
+	return current ? current : DIR_UP;
+}
+
+static void send_dir(client_t *c, snake_dir_t dir)
+{
+	byte_t payload[] = { (byte_t) dir };
+	out_len = 0;
+	telemetry_send(TM_CMD_DIR, payload, sizeof payload);
+	if (send(c->fd, out, out_len, MSG_NOSIGNAL) == (ssize_t) out_len)
+		c->sent_dir = dir; // otherwise it is tried again on the next tick
+}
+
+static long long period_us(unsigned int score)
+	{ return snake_score_to_speed(score, SPEED_CURVE_NORMAL) * 1000LL / speedup; }
+
+static void handle_frame(client_t *c, const telemetry_parser_t *p, long long now)
+{
+	if (p->type == TM_MSG_EVENT && p->len == 3) {
+		switch (p->payload[0]) {
+		case TM_EV_GAME_START:
+			c->is_playing = true;
+			c->last_us = now;
+			c->expected_us = period_us(1);
+			c->sent_dir = DIR_UNKNOWN;
+			/* fall through */
+		case TM_EV_RABBIT:
+			c->rabbit_x = p->payload[1];
+			c->rabbit_y = p->payload[2];
+			break;
+		case TM_EV_GAME_OVER:
+			c->is_playing = false;
+			++stats.games;
+			break;
+		}
+	} else if (p->type == TM_MSG_TICK && p->len == 9 && c->is_playing) {
+		long long late = now - c->last_us - c->expected_us;
+		if (late < 0)
+			late = 0; // server rounds due time to milliseconds
+		if (late > stats.max_lateness_us)
+			stats.max_lateness_us = late;
+		++stats.lateness[late / 100 < LATENESS_BUCKETS ? late / 100 : LATENESS_BUCKETS - 1];
+		++stats.ticks;
+
+		byte_t score = p->payload[6], head = p->payload[7];
+		c->last_us = now;
+		c->expected_us = period_us(score);
+		snake_dir_t dir = choose_dir(c, head >> 4, head & 0x0F, (int8_t) p->payload[8]);
+		if (dir != c->sent_dir)
+			send_dir(c, dir);
+	}
+}
+
+static void read_client(client_t *c)
+{
+	byte_t buf[1024];
+	for (;;) {
+		ssize_t n = recv(c->fd, buf, sizeof buf, 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && errno == EAGAIN)
+			return;
+		if (n <= 0) {
+			close(c->fd);
+			c->fd = -1;
+			--nopen;
+			return;
+		}
+		long long now = now_us();
+		for (ssize_t i = 0; i < n; ++i)
+			if (telemetry_parse_byte(&c->parser, buf[i]))
+				handle_frame(c, &c->parser, now);
+	}
+}
+
+static int connect_to(const char *path, int port)
+{
+	int fd;
+	if (path) {
+		struct sockaddr_un addr = { .sun_family = AF_UNIX };
+		strncpy(addr.sun_path, path, sizeof addr.sun_path - 1);
+		fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (fd >= 0 && connect(fd, (struct sockaddr *) &addr, sizeof addr) < 0) {
+			close(fd);
+			return -1;
+		}
+	} else {
+		struct sockaddr_in addr = {
+			.sin_family = AF_INET,
+			.sin_port = htons(port),
+			.sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+		};
+		fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (fd >= 0 && connect(fd, (struct sockaddr *) &addr, sizeof addr) < 0) {
+			close(fd);
+			return -1;
+		}
+	}
+	return fd;
+}
+
+static void raise_fd_limit()
+{
+	struct rlimit lim;
+	if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+		lim.rlim_cur = lim.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &lim);
+	}
+}
+
+/* utime + stime of process in microseconds, -1 if it can't be read */
+static long long process_cpu_us(int pid)
+{
+	char path[64], buf[1024];
+	snprintf(path, sizeof path, "/proc/%d/stat", pid);
+	FILE *f = fopen(path, "r");
+	if (!f)
+		return -1;
+	size_t n = fread(buf, 1, sizeof buf - 1, f);
+	fclose(f);
+	buf[n] = '\0';
+
+	char *p = strrchr(buf, ')'); // command may contain spaces
+	unsigned long utime, stime;
+	if (!p || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2)
+		return -1;
+	return (utime + stime) * 1000000LL / sysconf(_SC_CLK_TCK);
+}
+
+static long long lateness_percentile(double fraction)
+{
+	long long total = 0, seen = 0;
+	for (int i = 0; i < LATENESS_BUCKETS; ++i)
+		total += stats.lateness[i];
+	for (int i = 0; i < LATENESS_BUCKETS; ++i) {
+		seen += stats.lateness[i];
+		if (seen && seen >= total * fraction)
+			return (i + 1) * 100LL;
+	}
+	return 0;
+}
+
+static void report(const char *label, double seconds, long long server_cpu)
+{
+	printf("%s sessions %d, ticks/s %.0f, games %lld, late p50 %.1f ms p99 %.1f ms max %.1f ms",
+		label, nopen, stats.ticks / seconds, stats.games,
+		lateness_percentile(0.5) / 1000.0, lateness_percentile(0.99) / 1000.0, stats.max_lateness_us / 1000.0);
+	if (server_cpu >= 0)
+		printf(", server cpu %.1f%% (%.1f us/s per session)", 100.0 * server_cpu / (seconds * 1e6),
+			nopen ? server_cpu / seconds / nopen : 0.0);
+	printf("\n");
+	fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *path = NULL;
+	int port = 0, nsessions = 1000, duration_s = 10, server_pid = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "u:t:n:d:x:p:")) != -1) {
+		switch (opt) {
+		case 'u': path = optarg; break;
+		case 't': port = atoi(optarg); break;
+		case 'n': nsessions = atoi(optarg); break;
+		case 'd': duration_s = atoi(optarg); break;
+		case 'x': speedup = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+		case 'p': server_pid = atoi(optarg); break;
+		default:
+			goto usage;
+		}
+	}
+	if ((!path && !port) || nsessions <= 0)
+		goto usage;
+
+	raise_fd_limit();
+	int epfd = epoll_create1(EPOLL_CLOEXEC);
+	client_t *clients = calloc(nsessions, sizeof *clients);
+	for (int i = 0; i < nsessions; ++i) {
+		client_t *c = &clients[i];
+		c->fd = connect_to(path, port);
+		if (c->fd < 0) {
+			perror("server_load: connect");
+			return EXIT_FAILURE;
+		}
+		telemetry_parser_init(&c->parser);
+		fcntl(c->fd, F_SETFL, O_NONBLOCK); // connected blocking, served non-blocking
+		struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+		epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &ev);
+		++nopen;
+	}
+
+	long long start = now_us(), period_start = start;
+	long long server_cpu_start = server_pid ? process_cpu_us(server_pid) : -1;
+	long long server_cpu_period = server_cpu_start;
+	load_stats_t total = {};
+
+	for (;;) {
+		struct epoll_event events[MAX_EVENTS];
+		int n = epoll_wait(epfd, events, MAX_EVENTS, 100);
+		for (int i = 0; i < n; ++i)
+			read_client(events[i].data.ptr);
+
+		long long now = now_us();
+		if (now - period_start < 1000000 && now - start < duration_s * 1000000LL)
+			continue;
+
+		long long cpu = server_pid ? process_cpu_us(server_pid) : -1;
+		report("1s:", (now - period_start) / 1e6, cpu >= 0 && server_cpu_period >= 0 ? cpu - server_cpu_period : -1);
+		total.ticks += stats.ticks;
+		total.games += stats.games;
+		for (int i = 0; i < LATENESS_BUCKETS; ++i)
+			total.lateness[i] += stats.lateness[i];
+		if (stats.max_lateness_us > total.max_lateness_us)
+			total.max_lateness_us = stats.max_lateness_us;
+		memset(&stats, 0, sizeof stats);
+		period_start = now;
+		server_cpu_period = cpu;
+
+		if (now - start >= duration_s * 1000000LL) {
+			stats = total;
+			report("total:", (now - start) / 1e6,
+				cpu >= 0 && server_cpu_start >= 0 ? cpu - server_cpu_start : -1);
+			break;
+		}
+	}
+	for (int i = 0; i < nsessions; ++i)
+		if (clients[i].fd >= 0)
+			close(clients[i].fd);
+	free(clients);
+	return EXIT_SUCCESS;
+
+usage:
+	fprintf(stderr, "usage: %s (-u path | -t port) [-n sessions] [-d seconds] [-x speedup] [-p server_pid]\n", argv[0]);
+	return EXIT_FAILURE;
+}
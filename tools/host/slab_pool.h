@@ -0,0 +1,92 @@
+/* Pool of fixed-size objects for host programs
+ *  Objects are cut from slabs of SLAB_POOL_OBJECTS_PER_SLAB, freed objects go
+ * to a free list and are reused first, slabs are never returned before
+ * slab_pool_destroy(). So allocation is a pop from the list, sessions, which
+ * come and go, don't fragment the heap and stay close in memory.
+ *  Optional macros:
+ *  SLAB_POOL_OBJECTS_PER_SLAB -- default is 256
+ */
+
+#ifndef SLAB_POOL_H_
+#define SLAB_POOL_H_
+
+#include <stddef.h>
+#include <stdlib.h>
+#include "decls.h"
+
+#ifndef SLAB_POOL_OBJECTS_PER_SLAB
+#define SLAB_POOL_OBJECTS_PER_SLAB 256
+#endif // SLAB_POOL_OBJECTS_PER_SLAB
+
+typedef struct _slab_free_obj {
+	struct _slab_free_obj *next;
+} _slab_free_obj_t;
+
+/* objects are aligned for any member */
+typedef union { long long l; long double d; void *p; } _slab_align_t;
+
+typedef struct _slab {
+	struct _slab *next;
+	_slab_align_t objects[];
+} _slab_t;
+
+typedef struct {
+	size_t obj_size; // rounded up to alignment
+	_slab_t *slabs;
+	_slab_free_obj_t *free;
+	size_t nslabs, nused;
+} slab_pool_t;
+
+void slab_pool_init(slab_pool_t *p, size_t obj_size)
+{
+	size_t align = sizeof(_slab_align_t);
+	if (obj_size < sizeof(_slab_free_obj_t))
+		obj_size = sizeof(_slab_free_obj_t);
+	p->obj_size = (obj_size + align - 1) / align * align;
+	p->slabs = NULL;
+	p->free = NULL;
+	p->nslabs = p->nused = 0;
+}
+
+/* objects are not initialized, returns NULL if there is no memory */
+void *slab_pool_alloc(slab_pool_t *p)
+{
+	if (!p->free) {
+		_slab_t *slab = malloc(sizeof(_slab_t) + p->obj_size * SLAB_POOL_OBJECTS_PER_SLAB);
+		if (!slab)
+			return NULL;
+		slab->next = p->slabs;
+		p->slabs = slab;
+		++p->nslabs;
+		for (size_t i = SLAB_POOL_OBJECTS_PER_SLAB; i-- > 0; ) { // the first one on top
+			_slab_free_obj_t *obj = (_slab_free_obj_t *) ((char *) slab->objects + i * p->obj_size);
+			obj->next = p->free;
+			p->free = obj;
+		}
+	}
+	_slab_free_obj_t *obj = p->free;
+	p->free = obj->next;
+	++p->nused;
+	return obj;
+}
+
+void slab_pool_free(slab_pool_t *p, void *obj)
+{
+	_slab_free_obj_t *o = obj;
+	o->next = p->free;
+	p->free = o;
+	--p->nused;
+}
+
+void slab_pool_destroy(slab_pool_t *p)
+{
+	while (p->slabs) {
+		_slab_t *next = p->slabs->next;
+		free(p->slabs);
+		p->slabs = next;
+	}
+	p->free = NULL;
+	p->nslabs = p->nused = 0;
+}
+
+#endif // SLAB_POOL_H_
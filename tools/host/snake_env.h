@@ -0,0 +1,133 @@
+/* Batch of snake games as an environment for bots and learning agents
+ *  snake_env_step() moves every game of the batch by one tick with
+ * snake_game_update(), so games are exactly the device ones, and writes
+ * observations into the buffer of the caller: one snake_env_obs_t per game.
+ * Nothing is copied or allocated per step, body bitboards are updated only
+ * at the head and the tail. Finished games are restarted inside the step:
+ * their record has done set, final_score of the finished game and the state
+ * of the new one.
+ *  Games and observations are arrays of the caller, observations may be
+ * shared with another process through a file, see snake_env_map(). Record
+ * layout is fixed: body bitboard (bit cell & 63 of word cell >> 6),
+ * then score, final_score (uint16_t), head, rabbit (cell), dir, done (int8_t).
+ *  snake_game.h must be included before this file. Walls, spawn_mode and
+ * seed of games may be changed between snake_env_init() and snake_env_reset().
+ */
+
+#ifndef SNAKE_ENV_H_
+#define SNAKE_ENV_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "decls.h"
+
+#define SNAKE_ENV_WORDS ((SNAKE_NCELLS + 63) / 64)
+
+#define _SNAKE_ENV_BIT(cell) (1ULL << ((cell) & 63))
+
+typedef struct {
+	uint64_t body[SNAKE_ENV_WORDS];
+	uint16_t score;
+	uint16_t final_score; // score of the game, which finished on this step
+	cell_idx_t head, rabbit;
+	int8_t dir; // snake_dir_t
+	bool_t done;
+} snake_env_obs_t;
+
+typedef struct {
+	snake_game_t *games;
+	snake_env_obs_t *obs;
+	unsigned int n;
+} snake_env_t;
+
+/* games start on empty board with random rabbits, seeds are drawn from seed */
+void snake_env_init(snake_env_t *env, snake_game_t *games, snake_env_obs_t *obs, unsigned int n,
+	uint16_t seed)
+{
+	env->games = games;
+	env->obs = obs;
+	env->n = n;
+	if (seed == 0)
+		seed = 1;
+	for (unsigned int i = 0; i < n; ++i) {
+		memset(games[i].walls, 0, sizeof games[i].walls);
+		games[i].spawn_mode = SPAWN_RANDOM;
+		games[i].seed = snake_random(&seed);
+	}
+}
+
+static void _snake_env_observe(const snake_game_t *game, snake_env_obs_t *o)
+{
+	memset(o->body, 0, sizeof o->body);
+	for (cell_idx_t cell = 0; cell < SNAKE_NCELLS; ++cell)
+		if (MAP_ELEM(game->map, cell) == CELL_SNAKE)
+			o->body[cell >> 6] |= _SNAKE_ENV_BIT(cell);
+	o->score = game->score;
+	o->head = game->snake.segments[game->snake.head];
+	o->rabbit = game->rabbit;
+	o->dir = game->snake.dir;
+}
+
+void snake_env_reset(snake_env_t *env)
+{
+	for (unsigned int i = 0; i < env->n; ++i) {
+		snake_game_init(&env->games[i]);
+		_snake_env_observe(&env->games[i], &env->obs[i]);
+		env->obs[i].final_score = 0;
+		env->obs[i].done = false;
+	}
+}
+
+/*  actions[i] is the direction for game i, DIR_UNKNOWN keeps going ahead,
+ * as well as values, which aren't snake_dir_t (agents may send anything) */
+void snake_env_step(snake_env_t *env, const int8_t *actions)
+{
+	for (unsigned int i = 0; i < env->n; ++i) {
+		snake_game_t *game = &env->games[i];
+		snake_env_obs_t *o = &env->obs[i];
+		unsigned int tail = game->snake.tail;
+		cell_idx_t tail_cell = game->snake.segments[tail];
+		int8_t dir = actions[i];
+
+		if (dir < DIR_UP || dir > DIR_DOWN) // would index tables of the game out of bounds
+			dir = DIR_UNKNOWN;
+		snake_game_update(game, dir);
+		if (game->is_finished) {
+			o->final_score = game->score;
+			o->done = true;
+			snake_game_init(game);
+			_snake_env_observe(game, o);
+			continue;
+		}
+
+		/* tail is cleared first: head may move into the cell, which tail left */
+		if (game->snake.tail != tail)
+			o->body[tail_cell >> 6] &= ~_SNAKE_ENV_BIT(tail_cell);
+		o->head = game->snake.segments[game->snake.head];
+		o->body[o->head >> 6] |= _SNAKE_ENV_BIT(o->head);
+		o->score = game->score;
+		o->rabbit = game->rabbit;
+		o->dir = game->snake.dir;
+		o->done = false;
+	}
+}
+
+/*  Maps a file of n observation records for sharing with another process
+ * (e.g. numpy.memmap of the same file), returns NULL on failure */
+snake_env_obs_t *snake_env_map(const char *path, unsigned int n)
+{
+	size_t size = n * sizeof(snake_env_obs_t);
+	int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return NULL;
+	void *p = ftruncate(fd, size) == 0
+		? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+	return p == MAP_FAILED ? NULL : p;
+}
+
+void snake_env_unmap(snake_env_obs_t *obs, unsigned int n)
+	{ munmap(obs, n * sizeof(snake_env_obs_t)); }
+
+#endif // SNAKE_ENV_H_
@@ -0,0 +1,17 @@
+/* Batched environment (snake_env.h) as a shared library for agents in other
+ * languages, e.g. with python ctypes. Board is the device one, 8x8 with
+ * wrapping borders. Arrays of games and observations are allocated by the
+ * caller with the sizes below, games are opaque.
+ */
+
+#include <stddef.h>
+
+#define MAX_SNAKE_LENGTH 64
+#define SNAKE_GAME_WIDTH 8
+#define SNAKE_GAME_HEIGHT 8
+#include "snake_game.h"
+#include "snake_env.h"
+
+size_t snake_env_game_size() { return sizeof(snake_game_t); }
+size_t snake_env_obs_size() { return sizeof(snake_env_obs_t); }
+size_t snake_env_size() { return sizeof(snake_env_t); }
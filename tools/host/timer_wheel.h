@@ -0,0 +1,123 @@
+/* Hashed timer wheel for many timers on host
+ *  Time is counted in wheel ticks (game_server uses milliseconds). Timer goes
+ * to slot due % TIMER_WHEEL_SLOTS, timers, which are due more than one
+ * revolution later, share the slot and are skipped until their time. Adding
+ * and cancelling are O(1), timer_wheel_advance() visits only slots, which
+ * time passed through, so thousands of periodic timers cost nothing between
+ * their ticks.
+ *  Entries are intrusive: embed timer_wheel_entry_t into the owner and get
+ * the owner back with TIMER_WHEEL_OWNER().
+ *  Optional macros:
+ *  TIMER_WHEEL_SLOTS -- power of 2, default is 1024 (longer than any game period)
+ */
+
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "decls.h"
+
+#ifndef TIMER_WHEEL_SLOTS
+#define TIMER_WHEEL_SLOTS 1024
+#endif // TIMER_WHEEL_SLOTS
+
+#if TIMER_WHEEL_SLOTS & (TIMER_WHEEL_SLOTS - 1)
+#error "TIMER_WHEEL_SLOTS must be a power of 2"
+#endif
+
+#define TIMER_WHEEL_NEVER UINT64_MAX
+
+#define TIMER_WHEEL_OWNER(entry, type, member) \
+	((type *) ((char *) (entry) - offsetof(type, member)))
+
+typedef struct timer_wheel_entry {
+	struct timer_wheel_entry *next, *prev; // NULL, if not pending
+	uint64_t due;
+} timer_wheel_entry_t;
+
+typedef struct {
+	timer_wheel_entry_t slots[TIMER_WHEEL_SLOTS]; // heads of circular lists
+	uint64_t now; // timers, which are due before it, have fired
+	size_t npending;
+} timer_wheel_t;
+
+typedef void (*timer_wheel_callback_t)(timer_wheel_entry_t *entry);
+
+void timer_wheel_init(timer_wheel_t *w, uint64_t now)
+{
+	for (size_t i = 0; i < TIMER_WHEEL_SLOTS; ++i)
+		w->slots[i].next = w->slots[i].prev = &w->slots[i];
+	w->now = now;
+	w->npending = 0;
+}
+
+void timer_wheel_entry_init(timer_wheel_entry_t *e)
+	{ e->next = e->prev = NULL; }
+
+bool_t timer_wheel_is_pending(const timer_wheel_entry_t *e)
+	{ return e->next != NULL; }
+
+void timer_wheel_cancel(timer_wheel_t *w, timer_wheel_entry_t *e)
+{
+	if (!timer_wheel_is_pending(e))
+		return;
+	e->prev->next = e->next;
+	e->next->prev = e->prev;
+	e->next = e->prev = NULL;
+	--w->npending;
+}
+
+/* timer, which is due in the past, fires on the next advance */
+void timer_wheel_add(timer_wheel_t *w, timer_wheel_entry_t *e, uint64_t due)
+{
+	timer_wheel_cancel(w, e);
+	e->due = due < w->now ? w->now : due;
+	timer_wheel_entry_t *head = &w->slots[e->due & (TIMER_WHEEL_SLOTS - 1)];
+	e->next = head->next; // at front, so advance doesn't meet it in the same pass
+	e->prev = head;
+	head->next->prev = e;
+	head->next = e;
+	++w->npending;
+}
+
+/*  The earliest due time within one revolution, for poll timeouts: may be
+ * earlier than the real one (when only later rounds are pending), which
+ * only costs an empty advance */
+uint64_t timer_wheel_next_due(const timer_wheel_t *w)
+{
+	if (!w->npending)
+		return TIMER_WHEEL_NEVER;
+	for (uint64_t t = w->now; t < w->now + TIMER_WHEEL_SLOTS; ++t) {
+		const timer_wheel_entry_t *head = &w->slots[t & (TIMER_WHEEL_SLOTS - 1)];
+		if (head->next != head)
+			return t;
+	}
+	return w->now + TIMER_WHEEL_SLOTS;
+}
+
+/*  Fires timers, which are due up to now inclusive, in order of slots.
+ * Callback may add timers, including the one being fired */
+void timer_wheel_advance(timer_wheel_t *w, uint64_t now, timer_wheel_callback_t callback)
+{
+	if (now < w->now)
+		return;
+	uint64_t nslots = now - w->now + 1;
+	if (nslots > TIMER_WHEEL_SLOTS)
+		nslots = TIMER_WHEEL_SLOTS;
+
+	uint64_t start = w->now;
+	w->now = now + 1; // timers added by callbacks are due later
+	for (uint64_t t = start; t < start + nslots; ++t) {
+		timer_wheel_entry_t *head = &w->slots[t & (TIMER_WHEEL_SLOTS - 1)];
+		for (timer_wheel_entry_t *e = head->next, *next; e != head; e = next) {
+			next = e->next;
+			if (e->due > now)
+				continue; // later round
+			timer_wheel_cancel(w, e);
+			callback(e);
+		}
+	}
+}
+
+#endif // TIMER_WHEEL_H_
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""Dumps the sampling profiler of the snake game and prints a flat profile.
+
+Firmware must be built with the profiler:
+    make CFLAGS=-DPROFILER_ENABLE flash
+To fit in RAM, this build of main.c goes without the flight recorder and
+with rewind of 4 ticks (see the top of main.c).
+Buckets (see include/profiler.h) are matched against function symbols of
+the elf file (main.bin) from avr-nm, samples of a bucket are divided among
+functions in proportion to their overlap with it, so for small functions
+the profile is only as precise as the bucket size. To zoom in, rebuild with
+PROFILER_LOW set to the start of a hot function and smaller PROFILER_SHIFT.
+
+usage:
+    profiler_dump.py -p PORT [-e main.bin]   dump and print the profile
+    profiler_dump.py -p PORT --reset         clear counters
+"""
+
+import argparse
+import subprocess
+import sys
+import time
+
+from snake_client import Device, MSG_PROFILE, CMD_PROFILE
+
+OP_DUMP, OP_RESET = 0, 1
+END_MARKER = 0xFF
+
+
+def receive_profile(dev, timeout=5.0):
+    """returns (buckets, shift, low, outside)"""
+    counters = {}
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        for msg_type, payload in dev.receive_raw(0.5):
+            if msg_type != MSG_PROFILE or not payload:
+                continue
+            if payload[0] == END_MARKER and len(payload) == 6:
+                nbuckets, shift = payload[1], payload[2]
+                low = payload[3] | payload[4] << 8
+                return [counters.get(i, 0) for i in range(nbuckets)], shift, low, payload[5]
+            for i, value in enumerate(payload[1:]):
+                counters[payload[0] + i] = value
+    sys.exit('profiler_dump: no answer')
+
+
+def read_symbols(elf, nm):
+    """returns sorted list of (start, end, name) of functions, in bytes"""
+    try:
+        out = subprocess.run([nm, '-n', '-S', '--defined-only', elf],
+                             capture_output=True, text=True, check=True).stdout
+    except (OSError, subprocess.CalledProcessError) as e:
+        sys.exit('profiler_dump: %s' % e)
+    symbols = []
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) == 4 and fields[2] in 'tTwW':
+            start, size = int(fields[0], 16), int(fields[1], 16)
+            symbols.append((start, start + size, fields[3]))
+    return symbols
+
+
+def flat_profile(buckets, shift, low, symbols):
+    """returns {name: samples}, samples of a bucket are shared by overlap"""
+    result = {}
+    size = 1 << shift
+    for i, count in enumerate(buckets):
+        if not count:
+            continue
+        start = low + i * size
+        end = start + size
+        covered = 0
+        for sym_start, sym_end, name in symbols:
+            overlap = min(end, sym_end) - max(start, sym_start)
+            if overlap > 0:
+                result[name] = result.get(name, 0) + count * overlap / size
+                covered += overlap
+        if covered < size:
+            result['?'] = result.get('?', 0) + count * (size - covered) / size
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('-p', '--port', required=True)
+    parser.add_argument('--baud', type=int, default=9600)
+    parser.add_argument('-e', '--elf', default='main.bin')
+    parser.add_argument('--nm', default='avr-nm')
+    parser.add_argument('--reset', action='store_true')
+    parser.add_argument('--buckets', action='store_true', help='also print raw buckets')
+    args = parser.parse_args()
+
+    dev = Device(args.port, args.baud)
+    if args.reset:
+        dev.send(CMD_PROFILE, bytes([OP_RESET]))
+        return
+    dev.send(CMD_PROFILE, bytes([OP_DUMP]))
+    buckets, shift, low, outside = receive_profile(dev)
+
+    total = sum(buckets) + outside
+    if not total:
+        sys.exit('profiler_dump: no samples yet')
+    print('%d buckets of %d bytes from 0x%04x, %d samples, %d outside'
+          % (len(buckets), 1 << shift, low, total, outside))
+
+    profile = flat_profile(buckets, shift, low, read_symbols(args.elf, args.nm))
+    print('%7s %8s  %s' % ('%', 'samples', 'function'))
+    for name, samples in sorted(profile.items(), key=lambda item: -item[1]):
+        if samples >= 0.05:
+            print('%6.1f%% %8.1f  %s' % (100.0 * samples / total, samples, name))
+    if outside:
+        print('%6.1f%% %8d  (outside)' % (100.0 * outside / total, outside))
+
+    if args.buckets:
+        print()
+        for i, count in enumerate(buckets):
+            start = low + (i << shift)
+            print('0x%04x-0x%04x %5d %s' % (start, start + (1 << shift) - 1, count, '#' * (count * 40 // max(buckets))))
+
+
+if __name__ == '__main__':
+    main()
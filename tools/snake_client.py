@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+"""Host client for telemetry and remote control of the snake game.
+
+Protocol is described in include/telemetry.h. Works with the real device
+(serial port) or with tools/host/fake_device (pseudo-terminal).
+
+usage:
+    snake_client.py -p PORT monitor          print everything the device sends
+    snake_client.py -p PORT bot [-n TICKS]   drive the snake towards rabbits
+    snake_client.py -p PORT counters         print device counters
+    snake_client.py -p PORT settings I C S [L]  set intensity, speed curve, spawn mode, level
+    snake_client.py --fake PATH ...          start fake device and use its pty as PORT
+"""
+
+import argparse
+import os
+import select
+import struct
+import subprocess
+import sys
+import termios
+import time
+
+SYNC = 0xA5
+MAX_PAYLOAD = 16
+
+MSG_TICK, MSG_EVENT, MSG_COUNTERS, MSG_RENDER, MSG_FLIGHTREC, MSG_PROFILE = 0x01, 0x02, 0x03, 0x04, 0x05, 0x06
+CMD_DIR, CMD_BUTTON, CMD_GET_COUNTERS, CMD_SET_SETTINGS, CMD_FLIGHTREC, CMD_PROFILE = 0x81, 0x82, 0x83, 0x84, 0x85, 0x86
+
+EVENTS = {1: 'game_start', 2: 'rabbit', 3: 'game_over', 4: 'pause', 5: 'resume', 6: 'dir', 7: 'rewind'}
+DIR_LEFT, DIR_RIGHT, DIR_UP, DIR_DOWN = -1, 1, -2, 2
+DIR_NAMES = {0: 'unknown', DIR_LEFT: 'left', DIR_RIGHT: 'right', DIR_UP: 'up', DIR_DOWN: 'down'}
+BOARD_SIZE = 8
+
+
+def crc8(data, crc=0):
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def encode(msg_type, payload=b''):
+    body = bytes([msg_type, len(payload)]) + bytes(payload)
+    return bytes([SYNC]) + body + bytes([crc8(body)])
+
+
+class Parser:
+    """the same state machine as telemetry_parse_byte()"""
+
+    def __init__(self):
+        self.buf = bytearray()
+
+    def feed(self, data):
+        frames = []
+        for byte in data:
+            if not self.buf:
+                if byte == SYNC:
+                    self.buf.append(byte)
+                continue
+            self.buf.append(byte)
+            if len(self.buf) == 3 and self.buf[2] > MAX_PAYLOAD:
+                self.buf.clear()
+            elif len(self.buf) >= 4 and len(self.buf) == 4 + self.buf[2]:
+                body = bytes(self.buf[1:-1])
+                if crc8(body) == self.buf[-1]:
+                    frames.append((body[0], body[2:]))
+                self.buf.clear()
+        return frames
+
+
+def decode(msg_type, payload):
+    if msg_type == MSG_TICK and len(payload) == 9:
+        tick, period, duration, score, head, direction = struct.unpack('<HHHBBb', payload)
+        return {'msg': 'tick', 'tick': tick, 'period_ms': period * 2, 'duration_us': duration * 8,
+                'score': score, 'head': (head >> 4, head & 0x0F), 'dir': DIR_NAMES.get(direction, direction)}
+    if msg_type == MSG_EVENT and len(payload) == 3:
+        return {'msg': 'event', 'event': EVENTS.get(payload[0], payload[0]), 'args': (payload[1], payload[2])}
+    if msg_type == MSG_COUNTERS and len(payload) in (12, 14, 16):  # fake device has no stack and adc counters
+        names = ('duty_permille', 'sleeps', 'ticks', 'tx_dropped', 'rx_errors', 'frames_dropped', 'stack_unused',
+                 'adc_sleeps')
+        return dict(zip(names, struct.unpack('<%dH' % (len(payload) // 2), payload)), msg='counters')
+    if msg_type == MSG_RENDER and len(payload) in (4, 6):  # scroller cycles only if measured
+        names = ('subframes_per_s', 'cpu_permille', 'scroller_max_cycles')
+        return dict(zip(names, struct.unpack('<%dH' % (len(payload) // 2), payload)), msg='render')
+    return {'msg': 'unknown', 'type': msg_type, 'payload': payload.hex()}
+
+
+class Device:
+    def __init__(self, path, baud=9600):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        attrs = termios.tcgetattr(self.fd)
+        attrs[0] = attrs[1] = attrs[3] = 0  # raw: no input, output and local processing
+        attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+        speed = getattr(termios, 'B%d' % baud)
+        attrs[4] = attrs[5] = speed
+        termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        self.parser = Parser()
+
+    def send(self, msg_type, payload=b''):
+        os.write(self.fd, encode(msg_type, payload))
+
+    def receive(self, timeout):
+        """returns decoded frames, received during timeout seconds"""
+        return [decode(t, p) for t, p in self.receive_raw(timeout)]
+
+    def receive_raw(self, timeout):
+        """returns (type, payload) of frames, received during timeout seconds"""
+        frames = []
+        deadline = time.monotonic() + timeout
+        while True:
+            left = deadline - time.monotonic()
+            if left <= 0 or frames:
+                return frames
+            ready, _, _ = select.select([self.fd], [], [], left)
+            if ready:
+                try:
+                    data = os.read(self.fd, 256)
+                except OSError:  # fake device exited
+                    return frames
+                frames += self.parser.feed(data)
+
+
+def wrap_delta(src, dst):
+    """shortest signed distance on a torus"""
+    delta = (dst - src) % BOARD_SIZE
+    return delta - BOARD_SIZE if delta > BOARD_SIZE // 2 else delta
+
+
+def choose_dir(head, rabbit, current):
+    dx = wrap_delta(head[0], rabbit[0])
+    dy = wrap_delta(head[1], rabbit[1])
+    wanted = []
+    if dx:
+        wanted.append(DIR_RIGHT if dx > 0 else DIR_LEFT)
+    if dy:
+        wanted.append(DIR_DOWN if dy > 0 else DIR_UP)
+    for direction in wanted:
+        if direction != -current:  # snake can't turn back
+            return direction
+    return current if current else DIR_UP
+
+
+def run_monitor(dev, args):
+    while True:
+        for frame in dev.receive(1.0):
+            print(frame, flush=True)
+
+
+def run_bot(dev, args):
+    rabbit = None
+    ticks = 0
+    best = 0
+    while args.ticks < 0 or ticks < args.ticks:
+        frames = dev.receive(5.0)
+        if not frames:
+            sys.exit('snake_client: device is silent')
+        for frame in frames:
+            if frame['msg'] == 'event' and frame['event'] in ('game_start', 'rabbit'):
+                rabbit = frame['args']
+            elif frame['msg'] == 'event' and frame['event'] == 'rewind':
+                rabbit = (frame['args'][1] >> 4, frame['args'][1] & 0x0F)
+            elif frame['msg'] == 'event' and frame['event'] == 'game_over':
+                print('game over, score %d' % frame['args'][0], flush=True)
+            elif frame['msg'] == 'tick':
+                ticks += 1
+                best = max(best, frame['score'])
+                current = {v: k for k, v in DIR_NAMES.items()}[frame['dir']]
+                if rabbit is not None:
+                    dev.send(CMD_DIR, struct.pack('<b', choose_dir(frame['head'], rabbit, current)))
+    print('%d ticks, best score %d' % (ticks, best))
+
+
+def run_counters(dev, args):
+    dev.send(CMD_GET_COUNTERS)
+    answered = False
+    deadline = time.monotonic() + 3
+    while time.monotonic() < deadline:
+        for frame in dev.receive(0.5):
+            if frame['msg'] == 'counters':
+                print(frame)
+                answered = True
+            elif frame['msg'] == 'render':  # only real device sends it
+                print(frame)
+                return
+    if not answered:
+        sys.exit('snake_client: no answer')
+
+
+def run_settings(dev, args):
+    values = [args.intensity, args.curve, args.spawn] + ([args.level] if args.level is not None else [])
+    dev.send(CMD_SET_SETTINGS, bytes(values))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--fake', metavar='PATH', help='start fake device and connect to it')
+    parser.add_argument('--fake-speedup', type=int, default=10)
+    parser.add_argument('--baud', type=int, default=9600)
+    parser.add_argument('-p', '--port')
+    sub = parser.add_subparsers(dest='command', required=True)
+    sub.add_parser('monitor').set_defaults(func=run_monitor)
+    bot = sub.add_parser('bot')
+    bot.add_argument('-n', dest='ticks', type=int, default=-1, help='stop after this number of ticks')
+    bot.set_defaults(func=run_bot)
+    sub.add_parser('counters').set_defaults(func=run_counters)
+    settings = sub.add_parser('settings')
+    settings.add_argument('intensity', type=int)
+    settings.add_argument('curve', type=int)
+    settings.add_argument('spawn', type=int)
+    settings.add_argument('level', type=int, nargs='?')
+    settings.set_defaults(func=run_settings)
+    args = parser.parse_args()
+
+    fake = None
+    if args.fake:
+        fake = subprocess.Popen([args.fake, '-x', str(args.fake_speedup)], stdout=subprocess.PIPE, text=True)
+        args.port = fake.stdout.readline().strip()
+    if not args.port:
+        parser.error('PORT or --fake is required')
+
+    try:
+        args.func(Device(args.port, args.baud), args)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if fake:
+            fake.terminate()
+
+
+if __name__ == '__main__':
+    main()